@@ -0,0 +1,226 @@
+/**
+ * @brief DES 性能测试
+ * @note 直接包含 des.c 以测量其中的静态函数 feistel、calc_subkey、des_chunk；
+ * 与 REFERENCE=1 编译的版本对比即为与逐位置换参考实现的对比。
+ */
+#include "des.c"
+#include "fileio.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef DES_REFERENCE
+#define BUILD_NAME "reference"
+#else
+#define BUILD_NAME "optimized"
+#endif
+
+// 命令行选项
+static struct
+{
+    bool json;
+    bool header;
+    size_t max_bytes;
+    double min_seconds;
+} options = {false, true, 16 << 20, 0.2};
+
+// 防止被测函数的结果被优化掉
+static volatile uint64_t sink;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief 输出一行测试结果
+ * @param bytes 每次调用处理的字节数
+ * @param iterations 调用次数
+ */
+static void report(const char *stage, const char *impl, size_t bytes, long iterations, double seconds, uint64_t ticks)
+{
+    double total = (double)bytes * iterations;
+    double mbps = total / seconds / (1 << 20);
+    double cpb = ticks / total;
+    if (options.json)
+        printf("{\"build\":\"%s\",\"stage\":\"%s\",\"impl\":\"%s\",\"bytes\":%zu,\"iterations\":%ld,"
+               "\"seconds\":%.6f,\"mb_per_s\":%.3f,\"cycles_per_byte\":%.3f}\n",
+               BUILD_NAME, stage, impl, bytes, iterations, seconds, mbps, cpb);
+    else
+        printf("%s,%s,%s,%zu,%ld,%.6f,%.3f,%.3f\n", BUILD_NAME, stage, impl, bytes, iterations, seconds, mbps, cpb);
+    fflush(stdout);
+}
+
+/**
+ * @brief 重复执行 body 直到累计时间超过 min_seconds，执行次数每轮加倍以减少计时开销
+ * @note body 中可以使用循环变量 i_ 让每次的输入不同
+ */
+#define MEASURE(stage, impl, bytes, body)                                 \
+    do                                                                    \
+    {                                                                     \
+        long total_ = 0;                                                  \
+        double seconds_ = 0;                                              \
+        uint64_t ticks_ = 0;                                              \
+        for (long n_ = 1; seconds_ < options.min_seconds; n_ *= 2)        \
+        {                                                                 \
+            double t0_ = now();                                           \
+            uint64_t c0_ = cycles();                                      \
+            for (long i_ = 0; i_ < n_; ++i_)                              \
+            {                                                             \
+                body;                                                     \
+            }                                                             \
+            ticks_ += cycles() - c0_;                                     \
+            seconds_ += now() - t0_;                                      \
+            total_ += n_;                                                 \
+        }                                                                 \
+        report(stage, impl, bytes, total_, seconds_, ticks_);             \
+    } while (0)
+
+static void bench_stages()
+{
+    des_value_t subkeys[16];
+    uint64_t x = 0x0123456789ABCDEFULL;
+    calc_subkey(0x133457799BBCDFF1ULL, subkeys);
+    const des_value_t *passes[1] = {subkeys};
+
+    MEASURE("do_permutation", "reference", 8, x = do_permutation(&PERM_IP, x) + i_);
+    MEASURE("do_permutation", "lut", 8, x = do_permutation_lut(&PERM_IP_LUT, x) + i_);
+    MEASURE("feistel", BUILD_NAME, 4, x = feistel(x & 0xFFFFFFFF, subkeys[i_ & 15]) + i_);
+    MEASURE("calc_subkey", BUILD_NAME, 8, calc_subkey(x + i_, subkeys));
+    MEASURE("des_chunk", BUILD_NAME, 8, x = des_chunk(x + i_, passes, 1));
+    sink = x;
+}
+
+static void bench_backends()
+{
+    // 参考实现只有逐块处理的版本
+    static const char *BACKENDS[] = {"scalar", "bitslice", "sse2", "avx2", "avx512"};
+    const char *best = des_backend_name();
+    des_key_schedule_t schedule;
+    des_key_schedule(0x133457799BBCDFF1ULL, &schedule);
+    char *buf = (char *)malloc(options.max_bytes);
+    memset(buf, 0x5A, options.max_bytes);
+    for (int b = 0; b < (int)(sizeof(BACKENDS) / sizeof(BACKENDS[0])); ++b)
+    {
+        if (!des_use_backend(BACKENDS[b]))
+            continue;
+        if (backend && !backend->supported())
+            continue;
+        for (size_t bytes = 8; bytes <= options.max_bytes; bytes *= 8)
+            MEASURE("des_ecb_blocks", BACKENDS[b], bytes, des_ecb_blocks(&schedule, DES_ENCRYPT, buf, buf, bytes / 8));
+    }
+    des_use_backend(best);
+    free(buf);
+}
+
+/**
+ * @brief 对比常数时间模式与查表实现：单个块、逐块处理的 CBC 加密、可以批量处理的 CBC 解密和密钥编排
+ */
+static void bench_constant_time()
+{
+    des_key_schedule_t schedule;
+    des_key_schedule(0x133457799BBCDFF1ULL, &schedule);
+    size_t bytes = options.max_bytes < (1 << 20) ? options.max_bytes / 8 * 8 : 1 << 20;
+    char *buf = (char *)calloc(1, bytes);
+    char iv[8] = {0};
+    bool saved = des_constant_time();
+    for (int ct = 0; ct < 2; ++ct)
+    {
+        if (!des_set_constant_time(ct))
+            continue;
+        const char *impl = ct ? "constant-time" : "table";
+        des_value_t subkeys[16];
+        MEASURE("ecb_single_block", impl, 8, des_ecb_blocks(&schedule, DES_ENCRYPT, buf, buf, 1));
+        MEASURE("calc_subkey", impl, 8, calc_subkey(0x133457799BBCDFF1ULL + i_, subkeys));
+        for (int mode = DES_ENCRYPT; mode <= DES_DECRYPT; ++mode)
+            MEASURE(mode == DES_ENCRYPT ? "cbc_encrypt" : "cbc_decrypt", impl, bytes, {
+                struct des_stream *stream = des_open_schedule(mode, &schedule);
+                des_set_iv(stream, DES_CBC, iv);
+                des_crypt(stream, buf, bytes, buf, bytes);
+                free(stream);
+            });
+        sink = subkeys[15];
+    }
+    des_set_constant_time(saved);
+    free(buf);
+}
+
+/**
+ * @brief 测量命令行加密文件的完整路径：打开文件、映射、加密、截断
+ */
+static void bench_file()
+{
+    char inpath[] = "/tmp/des-bench-in-XXXXXX", outpath[] = "/tmp/des-bench-out-XXXXXX";
+    int infd = mkstemp(inpath), outfd = mkstemp(outpath);
+    if (infd < 0 || outfd < 0)
+    {
+        fprintf(stderr, "Unable to create temporary files\n");
+        return;
+    }
+    des_key_schedule_t schedule;
+    des_key_schedule(0x133457799BBCDFF1ULL, &schedule);
+    char *buf = (char *)calloc(1, options.max_bytes);
+    for (size_t bytes = 8; bytes <= options.max_bytes; bytes *= 8)
+    {
+        if (ftruncate(infd, 0) != 0 || pwrite(infd, buf, bytes, 0) != (ssize_t)bytes)
+            break;
+        MEASURE("file", des_backend_name(), bytes, {
+            int fd = open(outpath, O_RDWR | O_TRUNC);
+            if (mapped_crypt_file(des_open_schedule(DES_ENCRYPT, &schedule), infd, fd, 1) <= 0)
+                fprintf(stderr, "Unable to encrypt temporary file\n");
+            close(fd);
+        });
+    }
+    free(buf);
+    close(infd);
+    close(outfd);
+    unlink(inpath);
+    unlink(outpath);
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            options.json = true;
+        else if (strcmp(argv[i], "--no-header") == 0)
+            options.header = false;
+        else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+            options.max_bytes = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+            options.min_seconds = atof(argv[++i]);
+        else
+        {
+            printf("Usage: %s [--json] [--no-header] [--max bytes] [--time seconds]\n", argv[0]);
+            printf("Prints one CSV row (or JSON object per line) per stage, implementation and buffer size.\n");
+            return 1;
+        }
+    }
+    if (options.max_bytes < 8)
+        options.max_bytes = 8;
+
+    init_tables();
+    if (options.header && !options.json)
+        printf("build,stage,impl,bytes,iterations,seconds,mb_per_s,cycles_per_byte\n");
+    bench_stages();
+    bench_backends();
+    bench_constant_time();
+    bench_file();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "des.h"
+#include "fileio.h"
+
+/**
+ * 批量加密/解密中的一个文件
+ */
+struct batch_file
+{
+    const char *inpath;
+    const char *outpath;
+    // 处理结果：1 表示成功，-1 表示失败，error 为失败原因
+    int ret;
+    const char *error;
+    // 输入的字节数和处理用时
+    size_t bytes;
+    double seconds;
+};
+
+/**
+ * 批量加密/解密任务，所有文件共用同一个密钥编排
+ */
+struct batch_task
+{
+    int mode;
+    const des_key_schedule_t *schedule;
+    // 分组模式和 IV，iv 为 NULL 时使用 ECB
+    int chaining;
+    const char *iv;
+    // 每个文件的读写方式和缓冲区大小，见 crypt_fds
+    enum io_method io;
+    size_t buffer;
+    struct batch_file *files;
+    int nfiles;
+    // 工作线程数，每个线程每次处理一个文件
+    int threads;
+    // 全部完成的用时
+    double seconds;
+    /**
+     * @brief 每个文件处理完后调用，可为 NULL；调用时持有锁，各次调用不会同时进行
+     */
+    void (*done)(const struct batch_task *task, const struct batch_file *file);
+};
+
+/**
+ * @brief 在工作线程池中加密/解密 task 中的所有文件
+ * @note 工作线程依次领取下一个文件，每个线程有自己的 io_uring，单个文件只在一个线程中处理
+ * @return 失败的文件数
+ */
+int batch_crypt(struct batch_task *task);
+
+#endif // BATCH_H
@@ -0,0 +1,63 @@
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include "des.h"
+#include <stdbool.h>
+
+/**
+ * 位切片实现每次处理的块数，即一个 uint64_t 的位数
+ */
+#define BITSLICE_BLOCKS 64
+
+/**
+ * @brief 使用位切片方式同时对 64 个块做 DES 变换
+ * @note 64 个块先转置为 64 个 uint64_t，第 i 个数的第 j 位为第 j 个块的第 i 位，
+ * 此时所有置换都只是下标的重新排列，S 盒以布尔电路计算，不存在依赖数据的查表和分支，
+ * 因此运行时间与明文和密钥无关。
+ * @param subkeys 按使用顺序排列的 16 个子密钥
+ * @param blocks 64 个 64 位块，变换结果原地写回
+ */
+void des_bitslice(const des_value_t subkeys[16], uint64_t blocks[BITSLICE_BLOCKS]);
+
+/**
+ * 位切片内核的一种实现，SIMD 实现把位切片扩展到 128/256/512 位寄存器上
+ */
+typedef struct
+{
+    const char *name;
+    // 每次调用处理的块数
+    int blocks;
+    // 当前 CPU 是否支持该实现
+    bool (*supported)();
+    /**
+     * @brief 对每个块依次做 npasses 次 DES 变换，3DES 即为 3 次
+     * @param passes 每次变换按使用顺序排列的 16 个子密钥
+     * @param blocks 数量为 blocks 的 64 位块，变换结果原地写回
+     */
+    void (*run)(const des_value_t *const passes[], int npasses, uint64_t blocks[]);
+    /**
+     * @brief 用 blocks 个不同的密钥加密同一个明文，用于穷举密钥
+     * @param keys 数量为 blocks 的 64 位密钥
+     * @param match 数量为 blocks / 64，第 g 个数的第 j 位表示 keys[g * 64 + j] 加密 plain 得到 cipher
+     */
+    void (*search)(const uint64_t keys[], uint64_t plain, uint64_t cipher, uint64_t match[]);
+} bitslice_backend_t;
+
+/**
+ * 所有的位切片实现，按每次处理的块数从大到小排列，以 name 为 NULL 的项结尾
+ */
+extern const bitslice_backend_t BITSLICE_BACKENDS[];
+
+/**
+ * 各实现中每次处理块数的最大值
+ */
+#define BITSLICE_MAX_BLOCKS 512
+
+/**
+ * @brief 通过 cpuid 选择当前 CPU 支持的位切片实现
+ * @param name 实现的名字，为 NULL 时选择支持的最快实现
+ * @return 不存在或 CPU 不支持时返回 NULL
+ */
+const bitslice_backend_t *bitslice_backend(const char *name);
+
+#endif // BITSLICE_H
@@ -15,8 +15,36 @@ typedef uint64_t des_value_t;
 #define DES_ENCRYPT 0
 #define DES_DECRYPT 1
 
+// 分组模式
+#define DES_ECB 0
+#define DES_CBC 1
+#define DES_CFB 2
+#define DES_OFB 3
+#define DES_CTR 4
+
+/**
+ * DES 密钥编排：由密钥一次性生成的 16 个 48 位子密钥。
+ * subkeys[DES_ENCRYPT] 为加密时各轮依次使用的子密钥，subkeys[DES_DECRYPT] 为其逆序。
+ */
+typedef struct
+{
+    uint64_t key;
+    des_value_t subkeys[2][16];
+} des_key_schedule_t;
+
+/**
+ * 3DES 密钥编排，keys[0..2] 分别为 K1、K2、K3，EDE2 时 K3 = K1
+ */
+typedef struct
+{
+    des_key_schedule_t keys[3];
+} des3_key_schedule_t;
+
 struct des_stream
 {
+    // 流对象实际占用的字节数，des3_stream 比 des_stream 大
+    size_t size;
+
     // DES 64 位明文块/密文块
     char m[8];
 
@@ -29,10 +57,68 @@ struct des_stream
     int len;
     // 加密还是解密模式
     int mode;
+
+    // 缓存的密钥编排，同一个流只需要生成一次子密钥
+    des_key_schedule_t schedule;
+    bool has_schedule;
+
+    // 分组模式，默认为 DES_ECB
+    int chaining;
+    // CBC、CFB 为上一个密文块，OFB 为上一个输出块，CTR 为下一个计数器块
+    char iv[8];
+
+    // 以 mode 方向对连续的完整块做 ECB 加密/解密，单重 DES 与 3DES 的流使用不同的实现
+    void (*blocks)(struct des_stream *stream, int mode, const char in[], char out[], size_t nblocks);
 };
 
+/**
+ * 3DES 加密流，分块与填充的逻辑与单重 DES 的流相同
+ */
+struct des3_stream
+{
+    // 必须是第一个成员，des_final 会释放整个流
+    struct des_stream stream;
+    des3_key_schedule_t schedule;
+};
+
+/**
+ * @brief 由 64 位密钥生成密钥编排
+ * @param key 64 位密钥
+ * @param schedule 生成的密钥编排，可以被多个流共享
+ */
+void des_key_schedule(uint64_t key, des_key_schedule_t *schedule);
+
+/**
+ * @brief 打开 DES 加密流，密钥在第一次调用 des 时给出
+ */
 struct des_stream *des_open(int mode);
 
+/**
+ * @brief 设置流的分组模式和初始向量，需要在处理数据之前调用
+ * @param chaining DES_ECB、DES_CBC、DES_CFB、DES_OFB 或 DES_CTR
+ * @param iv 8 字节初始向量，CTR 模式下为初始计数器，ECB 模式下可以为 NULL
+ * @note CFB、OFB、CTR 模式不填充，输出与输入等长
+ */
+void des_set_iv(struct des_stream *stream, int chaining, const char iv[8]);
+
+/**
+ * @brief 复制加密流，包括密钥编排、分组模式和 IV，复制得到的流可以在其它线程中独立使用
+ * @return 新的流，使用 des_final 关闭或直接 free
+ */
+struct des_stream *des_clone(const struct des_stream *stream);
+
+/**
+ * @brief 按流的分组模式处理连续的 nblocks 个完整块，不做填充，也不保留最后一个明文块
+ * @note 仅在流中没有缓存数据时使用，用于调用者自行切分数据并行处理的场合；in 和 out 可以相同
+ */
+void des_update_blocks(struct des_stream *stream, const char in[], char out[], size_t nblocks);
+
+/**
+ * @brief 使用已经生成的密钥编排打开 DES 加密流，之后可以调用 des_update 和 des_final
+ * @param schedule 密钥编排，将被复制到流中
+ */
+struct des_stream *des_open_schedule(int mode, const des_key_schedule_t *schedule);
+
 /**
  * @brief 关闭 DES 加密流
  * @param c 输出的密文数组，需要确保该数组长度为 8 以上
@@ -41,6 +127,11 @@ struct des_stream *des_open(int mode);
  */
 int des_close(struct des_stream *stream, uint64_t key, char c[], int clen);
 
+/**
+ * @brief 使用流中的密钥编排关闭 DES 加密流，参数与返回值同 des_close
+ */
+int des_final(struct des_stream *stream, char c[], int clen);
+
 /**
  * @brief DES 加密算法
  * @param m 明文
@@ -52,14 +143,120 @@ int des_close(struct des_stream *stream, uint64_t key, char c[], int clen);
 int des(struct des_stream *stream, char m[], int len, uint64_t key, char c[], int clen);
 
 /**
- * @brief 生成 DES 使用的随机密钥
+ * @brief 使用流中的密钥编排进行 DES 加密，参数与返回值同 des
+ */
+int des_update(struct des_stream *stream, char m[], int len, char c[], int clen);
+
+/**
+ * @brief 处理一段连续的数据，完整的块直接从 m 写到 c，只在流中缓存最后不足一块的部分
+ * @note 与 des_update 不同，解密时不保留最后一个明文块，因此调用者需要把最后一段数据交给 des_crypt_final；
+ *       流中没有缓存数据（之前每次的长度都是 8 的倍数）时 m 和 c 可以相同，即原地处理
+ * @param clen 输出数组最大长度
+ * @return 输出的长度，输出数组不够长时返回 -1
+ */
+long des_crypt(struct des_stream *stream, const char m[], size_t len, char c[], size_t clen);
+
+/**
+ * @brief 处理最后一段连续的数据，加密时添加填充，解密时去除填充，然后关闭流
+ * @note m 和 c 可以相同，条件同 des_crypt；加密时输出数组需要比输入多留 8 字节，
+ *       需要填充的模式解密时 m 中必须包含最后一个块
+ * @return 输出的长度，输出数组不够长或填充不合法时返回 -1
+ */
+long des_crypt_final(struct des_stream *stream, const char m[], size_t len, char c[], size_t clen);
+
+/**
+ * @brief 选择 des_ecb_blocks 使用的实现，默认为当前 CPU 支持的最快 SIMD 实现，没有时为 scalar
+ * @param name "scalar" 表示逐块处理，其余为位切片实现："bitslice"、"sse2"、"avx2"、"avx512"
+ * @return 实现不存在或当前 CPU 不支持时返回 false
+ */
+bool des_use_backend(const char *name);
+
+/**
+ * @brief 当前 des_ecb_blocks 使用的实现的名字
+ */
+const char *des_backend_name();
+
+/**
+ * @brief 开启或关闭常数时间模式
+ * @note SP 盒和置换查找表以数据和密钥的字节为下标，访问的缓存行会泄露给同一主机上的其他进程。
+ * 常数时间模式下所有的块都由位切片实现处理，不足一批时补齐，逐块处理的 CBC/CFB 加密每块也要计算一整批，
+ * 因此这些模式会慢很多；密钥编排改为逐位置换。REFERENCE 构建没有位切片实现，不支持此模式。
+ * @return 不支持时返回 false
+ */
+bool des_set_constant_time(bool enable);
+
+/**
+ * @brief 是否处于常数时间模式
+ */
+bool des_constant_time();
+
+/**
+ * @brief 以 ECB 方式批量处理连续的 nblocks 个 64 位块
+ * @note 满一批的部分使用 des_use_backend 选择的位切片实现（REFERENCE 构建除外），其余的块逐块处理，
+ * 常数时间模式下其余的块补齐后交给位切片实现；
+ * in 和 out 可以相同
+ * @param schedule 密钥编排
+ * @param mode DES_ENCRYPT 或 DES_DECRYPT
+ * @param in 输入，长度为 nblocks * 8
+ * @param out 输出，长度为 nblocks * 8
+ */
+void des_ecb_blocks(const des_key_schedule_t *schedule, int mode, const char in[], char out[], size_t nblocks);
+
+/**
+ * @brief 生成 DES 使用的随机密钥，随机数取自 getrandom，不会生成弱密钥和半弱密钥
+ * @note 无法读取随机数时程序终止
  * @return DES 使用的随机密钥
  */
 uint64_t des_generate_key();
 
 /**
- * @brief 检查 DES 密钥是否合法
+ * @brief 批量生成 n 个随机密钥，一次从 getrandom 读取所有随机数，再查表设置奇校验位
+ * @note 弱密钥和半弱密钥会被重新生成
+ * @return 无法读取随机数时返回 false
+ */
+bool des_generate_keys(uint64_t keys[], size_t n);
+
+/**
+ * @brief 把密钥每个字节的最低位设为奇校验位
+ */
+uint64_t des_set_parity(uint64_t key);
+
+/**
+ * @brief 检查 DES 密钥是否合法，即每个字节都满足奇校验
  */
 bool des_verify_key(uint64_t key);
 
+/**
+ * @brief 是否为 FIPS 74 列出的弱密钥或半弱密钥
+ */
+bool des_weak_key(uint64_t key);
+
+/**
+ * @brief 由 3 个 64 位密钥生成 3DES 的密钥编排
+ * @param keys K1、K2、K3，EDE2 时传入 K1、K2、K1
+ */
+void des3_key_schedule(const uint64_t keys[3], des3_key_schedule_t *schedule);
+
+/**
+ * @brief 以 ECB 方式批量进行 3DES EDE 加密/解密，参数同 des_ecb_blocks
+ * @note 三次 DES 之间的 IP^(-1)·IP 相互抵消，每个块只做一次 IP 和 IP 逆置换
+ */
+void des3_ecb_blocks(const des3_key_schedule_t *schedule, int mode, const char in[], char out[], size_t nblocks);
+
+/**
+ * @brief 打开 3DES EDE 加密流
+ * @param schedule 密钥编排，将被复制到流中
+ */
+struct des3_stream *des3_open(int mode, const des3_key_schedule_t *schedule);
+
+/**
+ * @brief 3DES EDE 加密/解密，参数与返回值同 des_update
+ */
+int des3(struct des3_stream *stream, char m[], int len, char c[], int clen);
+
+/**
+ * @brief 关闭 3DES 加密流，参数与返回值同 des_final
+ */
+int des3_close(struct des3_stream *stream, char c[], int clen);
+
 #endif // DES_H
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include "des.h"
+
+/**
+ * @brief 通过内存映射加密/解密文件
+ * @note 输入映射为只读，输出先用 ftruncate 预分配再映射，完整的块直接从输入映射加密到输出映射，
+ * 只有最后的尾部和填充经过 stream 的缓冲区，最后再把输出截断为实际长度。
+ * @param stream 已经设置好分组模式和 IV 的加密流，成功或失败时都会被关闭
+ * @param infd 输入文件，必须是普通文件
+ * @param outfd 输出文件，需要以读写方式打开
+ * @param threads 工作线程数，见 parallel_update_blocks
+ * @return 1 表示成功，-1 表示输入不合法或读写失败，0 表示无法映射，此时 stream 未被使用
+ */
+int mapped_crypt_file(struct des_stream *stream, int infd, int outfd, int threads);
+
+/**
+ * io_uring 流水线使用的缓冲区个数
+ */
+#define URING_BUFFERS 4
+
+struct uring;
+
+/**
+ * @brief 通过 io_uring 流水线加密/解密普通文件
+ * @note 输入按 bufsize 分块，URING_BUFFERS 个缓冲区轮流使用：空闲的缓冲区立即提交后面的块的读请求，
+ * 读完的块按顺序在缓冲区中原地加密后提交写请求，写完后缓冲区再用于读取，因此加密当前块时仍有若干读写在进行。
+ * 文件长度已知，最后一块直接交给 des_crypt_final，不需要保留最后一个明文块。
+ * @param ring 已经初始化的 io_uring，队列长度至少为 URING_BUFFERS，只能由一个线程使用
+ * @param stream 已经设置好分组模式和 IV 的加密流，成功或失败时都会被关闭
+ * @param bufsize 每块的字节数，向上取整到页大小
+ * @return 1 表示成功，-1 表示输入不合法或读写失败，0 表示输入或输出不是普通文件，此时 stream 未被使用
+ */
+int uring_crypt_file(struct uring *ring, struct des_stream *stream, int infd, int outfd, size_t bufsize);
+
+/**
+ * @brief 以大缓冲区流式加密/解密，用于管道等无法映射的输入输出
+ * @note 两个读缓冲区轮流使用，后台线程读取下一块的同时加密当前块；每块都读满缓冲区，
+ * 因此除需要保留最后一个明文块的解密外都在读缓冲区中原地处理。输入输出为管道时尝试把管道容量扩大到一个缓冲区。
+ * @param stream 加密流，处理完成后被关闭
+ * @param bufsize 每次读取的字节数，向上取整为页大小的整数倍
+ * @return 1 表示成功，-1 表示输入不合法或读写失败
+ */
+int stream_crypt_file(struct des_stream *stream, int infd, int outfd, size_t bufsize);
+
+/**
+ * 普通文件的读写方式
+ */
+enum io_method
+{
+    IO_AUTO,
+    IO_MMAP,
+    IO_URING,
+    IO_STREAM
+};
+
+/**
+ * @brief 按 method 选择的方式加密/解密，不可用时依次退回内存映射和流式处理
+ * @param ring 已经初始化的 io_uring，为 NULL 时不使用 io_uring，IO_AUTO 在 ring 不为 NULL 时优先使用
+ * @param threads 内存映射时的工作线程数
+ * @param bufsize io_uring 和流式处理时每块的字节数
+ * @return 1 表示成功，-1 表示输入不合法或读写失败，stream 总是被关闭
+ */
+int crypt_fds(struct des_stream *stream, int infd, int outfd, struct uring *ring, enum io_method method, int threads, size_t bufsize);
+
+#endif // FILEIO_H
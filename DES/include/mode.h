@@ -0,0 +1,23 @@
+#ifndef MODE_H
+#define MODE_H
+
+#include "des.h"
+
+/**
+ * @brief 分组模式是否需要对最后一块进行填充
+ * @note ECB 和 CBC 需要填充，CFB、OFB、CTR 以流的方式工作，密文与明文等长
+ */
+bool chain_padded(int chaining);
+
+/**
+ * @brief 按流的分组模式加密/解密连续的 nblocks 个完整块，并更新流中的 IV
+ * @note CBC 解密、CFB 解密和 CTR 可以并行，会批量交给 stream->blocks 处理；in 和 out 可以相同
+ */
+void chain_blocks(struct des_stream *stream, const char in[], char out[], size_t nblocks);
+
+/**
+ * @brief 以流的方式处理最后不足一块的 len 字节，仅用于 CFB、OFB、CTR
+ */
+void chain_tail(struct des_stream *stream, const char in[], char out[], int len);
+
+#endif // MODE_H
@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "des.h"
+
+/**
+ * @brief 与 des_update_blocks 相同，但在可以并行的分组模式下切分为若干段交给多个线程处理
+ * @note 可以并行的模式为 ECB、CTR、CBC 解密和 CFB 解密，其余模式在调用线程中串行处理。
+ * 每段的 IV 在开始前由调用线程计算，因此 in 和 out 可以相同；各段写回输出中的相同偏移处，
+ * 结果以及处理完成后流中的 IV 都与串行处理完全相同。
+ * @param stream 已经设置好分组模式和 IV 的加密流，且没有缓存的数据
+ * @param threads 工作线程数
+ */
+void parallel_update_blocks(struct des_stream *stream, const char in[], char out[], size_t nblocks, int threads);
+
+#endif // PARALLEL_H
@@ -1,6 +1,7 @@
 #ifndef PERMUTATION_H
 #define PERMUTATION_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct
@@ -10,6 +11,17 @@ typedef struct
     int table[64];
 } permutation_t;
 
+/**
+ * 由 permutation_t 展开得到的按字节查找表
+ * table[i][b] 表示输入的第 i 个字节（从最低字节算起）取值为 b 时置换结果中被置 1 的位，
+ * 置换结果即为各字节查表结果的按位或。
+ */
+typedef struct
+{
+    int from_bytes;
+    uint64_t table[8][256];
+} permutation_lut_t;
+
 /**
  * @brief 根据置换表 table，将 chunk 进行置换
  * @param perm 置换表，表中每个元素 e 表示对应位置 i 置换为 chunk[e]
@@ -18,6 +30,27 @@ typedef struct
  */
 uint64_t do_permutation(const permutation_t *perm, uint64_t chunk);
 
+/**
+ * @brief 将置换表 perm 展开为按字节查找表
+ * @param perm 置换表
+ * @param lut 生成的查找表
+ */
+void compile_permutation(const permutation_t *perm, permutation_lut_t *lut);
+
+/**
+ * @brief 检查查找表 lut 的每一项是否与逐位置换 do_permutation 的结果一致
+ * @return 查找表与置换表 perm 一致时返回 true
+ */
+bool check_permutation_lut(const permutation_t *perm, const permutation_lut_t *lut);
+
+/**
+ * @brief 根据查找表 lut 将 chunk 进行置换，结果与 do_permutation 相同
+ * @param lut 由 compile_permutation 生成的查找表
+ * @param chunk 将被置换的数组
+ * @return 置换后的数组
+ */
+uint64_t do_permutation_lut(const permutation_lut_t *lut, uint64_t chunk);
+
 /**
  * @brief 做 DES 的 S-Box 选择
  * @note S-Box 选择函数是 6 位转 4 位的变换。
@@ -77,4 +110,9 @@ extern const permutation_t PERM_PC2;
  */
 extern const permutation_t PERM_REMOVE_PARITY;
 
+/**
+ * SP 盒、上述置换表展开后的查找表以及位切片内核的映射表在编译时由 tools/gentables.c 生成，
+ * 以 static const 数据的形式定义在 des_tables.h 中
+ */
+
 #endif // PERMUTATION_H
\ No newline at end of file
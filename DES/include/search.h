@@ -0,0 +1,47 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "des.h"
+
+/**
+ * 一次密钥搜索最多记录的匹配密钥数
+ */
+#define SEARCH_MAX_FOUND 16
+
+/**
+ * 密钥搜索任务，密钥以 56 位下标表示，见 search_key
+ */
+struct search_task
+{
+    // 已知的明文、密文对
+    uint64_t plain;
+    uint64_t cipher;
+    // 搜索范围 [next, end)，搜索过程中 next 不断前进，之前的下标都已搜索完毕，可用于断点续搜
+    uint64_t next;
+    uint64_t end;
+    // 工作线程数
+    int threads;
+    // 找到的密钥
+    uint64_t found[SEARCH_MAX_FOUND];
+    int nfound;
+    /**
+     * @brief 搜索过程中大约每秒调用一次，可为 NULL
+     * @param searched 从开始搜索以来检查过的密钥数
+     * @param keys_per_second 最近一段时间的速度
+     */
+    void (*progress)(const struct search_task *task, uint64_t searched, double keys_per_second);
+};
+
+/**
+ * @brief 由 56 位下标生成密钥，下标的每 7 位依次作为密钥每个字节的高 7 位，并设置奇校验位
+ */
+uint64_t search_key(uint64_t index);
+
+/**
+ * @brief 多线程穷举密钥，使用当前 CPU 支持的最宽的位切片实现，每次同时试验一批密钥
+ * @note 找到匹配的密钥后，各线程完成手上的段即停止；des_use_backend 选择 scalar 时使用便携的位切片实现，DES_REFERENCE 时逐个密钥生成编排并加密
+ * @return 检查过的密钥数
+ */
+uint64_t search_keys(struct search_task *task);
+
+#endif // SEARCH_H
@@ -0,0 +1,15 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+/**
+ * @brief DES 自检
+ * @note 包括 FIPS 81 / NBS SP 500-20 的已知答案测试（单位明文、单位密钥和各分组模式的例子），
+ * 各个实现与逐块 des_chunk 的随机差分测试，位切片密钥搜索内核的测试，以及把数据切成任意长度分段送入 des_update 时
+ * 与一次性处理的结果是否一致，覆盖 des_final 的填充和去除填充。
+ * 每个当前 CPU 支持的实现都会在普通模式和常数时间模式下各测试一次，结束后恢复原来选择的实现和模式。
+ * @param seed 随机测试使用的种子
+ * @return 失败的测试数，失败的详情输出到 stderr
+ */
+int des_selftest(unsigned int seed);
+
+#endif // SELFTEST_H
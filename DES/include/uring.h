@@ -0,0 +1,62 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * 直接使用系统调用的最小 io_uring 封装，只支持读写
+ * 提交队列和完成队列通过 mmap 与内核共享，一次 io_uring_enter 即可提交多个请求并等待完成
+ */
+struct uring
+{
+    int fd;
+    unsigned entries;
+    // 提交队列
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    // 完成队列
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    // 已放入提交队列但还没有提交给内核的请求数
+    unsigned pending;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+};
+
+/**
+ * @brief 创建 io_uring
+ * @param entries 队列长度，即最多同时进行的请求数
+ * @return 内核不支持或者被禁止时返回 false，调用者应退回普通的读写
+ */
+bool uring_init(struct uring *ring, unsigned entries);
+
+/**
+ * @brief 关闭 io_uring 并释放映射的队列
+ */
+void uring_exit(struct uring *ring);
+
+/**
+ * @brief 把一个读/写请求放入提交队列，在下一次 uring_wait 时提交
+ * @param write 为 true 时写入 fd，否则读取
+ * @param offset 文件中的偏移
+ * @param user_data 完成时原样返回，用于识别请求
+ * @return 提交队列已满时返回 false
+ */
+bool uring_prep_rw(struct uring *ring, bool write, int fd, void *buf, unsigned len, off_t offset, uint64_t user_data);
+
+/**
+ * @brief 提交队列中的请求，并等待至少 min_complete 个请求完成
+ * @return 出错时返回 false
+ */
+bool uring_wait(struct uring *ring, unsigned min_complete);
+
+/**
+ * @brief 取出一个已完成的请求
+ * @param res 请求的结果，即读写的字节数，出错时为负的 errno
+ * @return 没有已完成的请求时返回 false
+ */
+bool uring_next(struct uring *ring, uint64_t *user_data, int *res);
+
+#endif // URING_H
@@ -0,0 +1,121 @@
+#include "batch.h"
+#include "uring.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+struct job
+{
+    struct batch_task *task;
+    // 下一个待领取的文件
+    int next;
+    int failures;
+    pthread_mutex_t lock;
+};
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief 打开 file 的输入输出并加密/解密
+ * @param ring 当前线程的 io_uring，可为 NULL
+ */
+static void crypt_one(const struct batch_task *task, struct batch_file *file, struct uring *ring)
+{
+    double start = now();
+    file->ret = -1;
+    int infd = open(file->inpath, O_RDONLY);
+    if (infd < 0)
+    {
+        file->error = "Unable to open input file";
+        return;
+    }
+    int outfd = open(file->outpath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (outfd < 0)
+    {
+        close(infd);
+        file->error = "Unable to open output file";
+        return;
+    }
+
+    struct stat st;
+    file->bytes = fstat(infd, &st) == 0 ? st.st_size : 0;
+    struct des_stream *stream = des_open_schedule(task->mode, task->schedule);
+    if (task->iv)
+        des_set_iv(stream, task->chaining, task->iv);
+    // 文件之间已经并行，单个文件不再分给多个线程
+    file->ret = crypt_fds(stream, infd, outfd, ring, task->io, 1, task->buffer);
+    if (file->ret < 0)
+        file->error = "Unable to process input file";
+    close(infd);
+    close(outfd);
+    file->seconds = now() - start;
+}
+
+static void *worker(void *arg)
+{
+    struct job *job = (struct job *)arg;
+    struct batch_task *task = job->task;
+    struct uring ring;
+    bool has_ring = (task->io == IO_AUTO || task->io == IO_URING) && uring_init(&ring, 2 * URING_BUFFERS);
+
+    while (true)
+    {
+        pthread_mutex_lock(&job->lock);
+        int i = job->next < task->nfiles ? job->next++ : -1;
+        pthread_mutex_unlock(&job->lock);
+        if (i < 0)
+            break;
+
+        struct batch_file *file = &task->files[i];
+        crypt_one(task, file, has_ring ? &ring : NULL);
+
+        pthread_mutex_lock(&job->lock);
+        if (file->ret < 0)
+            job->failures++;
+        if (task->done)
+            task->done(task, file);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    if (has_ring)
+        uring_exit(&ring);
+    return NULL;
+}
+
+int batch_crypt(struct batch_task *task)
+{
+    struct job job;
+    job.task = task;
+    job.next = 0;
+    job.failures = 0;
+    pthread_mutex_init(&job.lock, NULL);
+
+    double start = now();
+    int threads = task->threads > 0 ? task->threads : 1;
+    if (threads > task->nfiles)
+        threads = task->nfiles;
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+
+    // 线程创建失败时，由调用线程完成剩余的文件
+    int started = 0;
+    for (; started < threads; ++started)
+        if (pthread_create(&tids[started], NULL, worker, &job) != 0)
+            break;
+    if (started < threads)
+        worker(&job);
+    for (int i = 0; i < started; ++i)
+        pthread_join(tids[i], NULL);
+
+    task->seconds = now() - start;
+    pthread_mutex_destroy(&job.lock);
+    free(tids);
+    return job.failures;
+}
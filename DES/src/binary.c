@@ -19,7 +19,7 @@ uint64_t loop_shl(uint64_t chunk, int len, int bits)
     {
         chunk = (chunk << 1) | ((chunk >> (len - 1)) & 1);
     }
-    return chunk & ~(~0 << len);
+    return chunk & ~(~0ULL << len);
 }
 
 int count_bits(uint64_t chunk, uint64_t mask)
@@ -0,0 +1,85 @@
+#include "bitslice.h"
+#include "des_tables.h"
+#include <string.h>
+
+/**
+ * @brief 转置 64x64 的位矩阵，转置后 a[i] 的第 j 位为原 a[j] 的第 i 位
+ */
+static void transpose64(uint64_t a[64])
+{
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j)
+    {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j)
+        {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+// 以不同的寄存器宽度实例化位切片内核，见 bitslice_kernel.h
+
+#define BS_LANE uint64_t
+#define BS_WORDS 1
+#define BS_NAME(name) name##_scalar
+#define BS_TARGET
+#include "bitslice_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITSLICE_X86
+
+typedef uint64_t u64x2 __attribute__((vector_size(16)));
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+typedef uint64_t u64x8 __attribute__((vector_size(64)));
+
+#define BS_LANE u64x2
+#define BS_WORDS 2
+#define BS_NAME(name) name##_sse2
+#define BS_TARGET __attribute__((target("sse2")))
+#include "bitslice_kernel.h"
+
+#define BS_LANE u64x4
+#define BS_WORDS 4
+#define BS_NAME(name) name##_avx2
+#define BS_TARGET __attribute__((target("avx2")))
+#include "bitslice_kernel.h"
+
+#define BS_LANE u64x8
+#define BS_WORDS 8
+#define BS_NAME(name) name##_avx512
+#define BS_TARGET __attribute__((target("avx512f")))
+#include "bitslice_kernel.h"
+
+static bool supports_sse2() { return __builtin_cpu_supports("sse2"); }
+static bool supports_avx2() { return __builtin_cpu_supports("avx2"); }
+static bool supports_avx512() { return __builtin_cpu_supports("avx512f"); }
+#endif
+
+static bool supports_scalar() { return true; }
+
+const bitslice_backend_t BITSLICE_BACKENDS[] = {
+#ifdef BITSLICE_X86
+    {"avx512", 512, supports_avx512, des_bitslice_avx512, des_search_avx512},
+    {"avx2", 256, supports_avx2, des_bitslice_avx2, des_search_avx2},
+    {"sse2", 128, supports_sse2, des_bitslice_sse2, des_search_sse2},
+#endif
+    {"bitslice", 64, supports_scalar, des_bitslice_scalar, des_search_scalar},
+    {NULL, 0, NULL, NULL, NULL}};
+
+const bitslice_backend_t *bitslice_backend(const char *name)
+{
+#ifdef BITSLICE_X86
+    __builtin_cpu_init();
+#endif
+    for (const bitslice_backend_t *p = BITSLICE_BACKENDS; p->name; ++p)
+        if ((!name || strcmp(name, p->name) == 0) && p->supported())
+            return p;
+    return NULL;
+}
+
+void des_bitslice(const des_value_t subkeys[16], uint64_t blocks[BITSLICE_BLOCKS])
+{
+    des_bitslice_scalar(&subkeys, 1, blocks);
+}
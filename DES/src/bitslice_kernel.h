@@ -0,0 +1,174 @@
+/**
+ * 位切片 DES 内核模板，由 bitslice.c 以不同的寄存器宽度多次包含。
+ * 包含前需要定义：
+ *   BS_LANE   保存一位切片的类型，uint64_t 或者 GCC 向量类型
+ *   BS_WORDS  BS_LANE 中 uint64_t 的个数，每次处理 64 * BS_WORDS 个块
+ *   BS_NAME   为函数名加上后缀
+ *   BS_TARGET 函数的 target 属性，用于生成对应指令集的代码
+ */
+
+static BS_TARGET BS_LANE BS_NAME(mux)(BS_LANE a, BS_LANE b, BS_LANE sel)
+{
+    return a ^ ((a ^ b) & sel);
+}
+
+/**
+ * @brief 以布尔电路计算第 s 个 S 盒
+ * @note 先求出关于最低 2 位输入的全部 16 个布尔函数，再以其余 4 位输入为选择信号逐层选择。
+ * 查表下标只依赖 S 盒常量，与数据无关。
+ * @param x 6 位输入，x[0] 为最低位
+ * @param out 4 位输出，out[0] 为最低位
+ */
+static BS_TARGET void BS_NAME(sbox)(int s, const BS_LANE x[6], BS_LANE out[4])
+{
+    BS_LANE f[16];
+    f[0] = (BS_LANE){0};
+    f[1] = ~x[0] & ~x[1];
+    f[2] = x[0] & ~x[1];
+    f[4] = ~x[0] & x[1];
+    f[8] = x[0] & x[1];
+    for (int t = 3; t < 16; ++t)
+        if (t & (t - 1))
+            f[t] = f[t & (t - 1)] | f[t & -t];
+
+    for (int o = 0; o < 4; ++o)
+    {
+        const int *leaf = SBOX_LEAF[s][o];
+        BS_LANE l3[8], l4[4], l5[2];
+        for (int i = 0; i < 8; ++i)
+            l3[i] = BS_NAME(mux)(f[leaf[2 * i]], f[leaf[2 * i + 1]], x[2]);
+        for (int i = 0; i < 4; ++i)
+            l4[i] = BS_NAME(mux)(l3[2 * i], l3[2 * i + 1], x[3]);
+        for (int i = 0; i < 2; ++i)
+            l5[i] = BS_NAME(mux)(l4[2 * i], l4[2 * i + 1], x[4]);
+        out[o] = BS_NAME(mux)(l5[0], l5[1], x[5]);
+    }
+}
+
+/**
+ * @brief 对 64 * BS_WORDS 个块依次做 npasses 次 DES 变换，第 g 组 64 个块位于各切片的第 g 个 uint64_t 中
+ * @note 相邻两次 DES 之间的 IP^(-1) 和 IP 相互抵消，只在首尾做一次
+ */
+static BS_TARGET void BS_NAME(des_bitslice)(const des_value_t *const passes[], int npasses, uint64_t blocks[])
+{
+    uint64_t words[64][BS_WORDS];
+    BS_LANE in[64], lr[2][32], pre[64];
+    BS_LANE *l = lr[0], *r = lr[1];
+
+    for (int g = 0; g < BS_WORDS; ++g)
+    {
+        transpose64(blocks + g * 64);
+        for (int q = 0; q < 64; ++q)
+            words[q][g] = blocks[g * 64 + q];
+    }
+    memcpy(in, words, sizeof(in));
+
+    // IP 置换只需重新排列下标
+    for (int q = 0; q < 32; ++q)
+    {
+        r[q] = in[IP_MAP[q]];
+        l[q] = in[IP_MAP[q + 32]];
+    }
+
+    for (int p = 0; p < npasses; ++p)
+    {
+        const des_value_t *subkeys = passes[p];
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int s = 0; s < 8; ++s)
+            {
+                BS_LANE x[6], out[4];
+                for (int b = 0; b < 6; ++b)
+                    x[b] = r[E_MAP[s][b]] ^ ((BS_LANE){0} - ((subkeys[i] >> KEY_MAP[s][b]) & 1));
+                BS_NAME(sbox)(s, x, out);
+                // L[i] = R[i-1]，R[i] = L[i-1] ^ f(R[i-1], K[i])，直接异或到 L 上再交换
+                for (int o = 0; o < 4; ++o)
+                    l[P_MAP[s][o]] ^= out[o];
+            }
+            BS_LANE *t = l;
+            l = r;
+            r = t;
+        }
+        // 最后交换左右两半，即 R[16]L[16]，也就是下一次 DES 的 L[0]R[0]
+        BS_LANE *t = l;
+        l = r;
+        r = t;
+    }
+
+    // 再做 IP 逆置换
+    for (int q = 0; q < 32; ++q)
+    {
+        pre[q] = r[q];
+        pre[q + 32] = l[q];
+    }
+    for (int q = 0; q < 64; ++q)
+        in[q] = pre[IPINV_MAP[q]];
+
+    memcpy(words, in, sizeof(in));
+    for (int g = 0; g < BS_WORDS; ++g)
+    {
+        for (int q = 0; q < 64; ++q)
+            blocks[g * 64 + q] = words[q][g];
+        transpose64(blocks + g * 64);
+    }
+}
+
+/**
+ * @brief 以 64 * BS_WORDS 个不同的密钥加密同一个明文，检查密文是否等于 cipher
+ * @note 密钥同样按位转置，每轮的子密钥位直接取自 ROUND_KEY_MAP 指出的密钥切片，不需要生成密钥编排；
+ * 明文和密文对所有块都相同，因此 IP 和 IP 逆置换都在常量上完成。
+ * @param keys 64 * BS_WORDS 个 64 位密钥
+ * @param match 第 g 个 uint64_t 的第 j 位表示 keys[g * 64 + j] 是否匹配
+ */
+static BS_TARGET void BS_NAME(des_search)(const uint64_t keys[], uint64_t plain, uint64_t cipher, uint64_t match[])
+{
+    uint64_t words[64][BS_WORDS], tmp[64];
+    BS_LANE k[64], lr[2][32];
+    BS_LANE *l = lr[0], *r = lr[1];
+
+    for (int g = 0; g < BS_WORDS; ++g)
+    {
+        memcpy(tmp, keys + g * 64, sizeof(tmp));
+        transpose64(tmp);
+        for (int q = 0; q < 64; ++q)
+            words[q][g] = tmp[q];
+    }
+    memcpy(k, words, sizeof(k));
+
+    for (int q = 0; q < 32; ++q)
+    {
+        r[q] = (BS_LANE){0} - ((plain >> IP_MAP[q]) & 1);
+        l[q] = (BS_LANE){0} - ((plain >> IP_MAP[q + 32]) & 1);
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int s = 0; s < 8; ++s)
+        {
+            BS_LANE x[6], out[4];
+            for (int b = 0; b < 6; ++b)
+                x[b] = r[E_MAP[s][b]] ^ k[ROUND_KEY_MAP[i][s][b]];
+            BS_NAME(sbox)(s, x, out);
+            for (int o = 0; o < 4; ++o)
+                l[P_MAP[s][o]] ^= out[o];
+        }
+        BS_LANE *t = l;
+        l = r;
+        r = t;
+    }
+
+    // 输出为 IP^(-1)(R[16]L[16])，等价于比较 R[16]L[16] 与 IP(cipher)
+    BS_LANE diff = (BS_LANE){0};
+    for (int q = 0; q < 32; ++q)
+    {
+        diff |= l[q] ^ ((BS_LANE){0} - ((cipher >> IP_MAP[q]) & 1));
+        diff |= r[q] ^ ((BS_LANE){0} - ((cipher >> IP_MAP[q + 32]) & 1));
+    }
+    diff = ~diff;
+    memcpy(match, &diff, sizeof(diff));
+}
+
+#undef BS_LANE
+#undef BS_WORDS
+#undef BS_NAME
+#undef BS_TARGET
@@ -1,8 +1,20 @@
 #include "des.h"
 #include "permutation.h"
+#include "des_tables.h"
 #include "binary.h"
+#include "bitslice.h"
+#include "mode.h"
+#include <stdio.h>
 #include <string.h>
 
+#ifdef DES_REFERENCE
+#define PERMUTE(perm, chunk) do_permutation(&perm, chunk)
+#else
+#define PERMUTE(perm, chunk) do_permutation_lut(&perm##_LUT, chunk)
+#endif
+
+#ifdef DES_REFERENCE
+
 /**
  * @brief Feistel 轮函数
  * @param r 长度为 32 位的串 R[i - 1]
@@ -33,8 +45,44 @@ static des_value_t feistel(des_value_t r, des_value_t k)
     return do_permutation(&PERM_P, s);
 }
 
+#else
+
+static uint32_t rotl32(uint32_t x, int bits)
+{
+    return (x << bits) | (x >> (32 - bits));
+}
+
+/**
+ * @brief Feistel 轮函数，SP 盒查表实现
+ * @note E-扩展的第 i 个 6 位分组恰好是 R 循环左移 4i+5 位后的低 6 位，因此不需要逐位置换；
+ * S 盒选择和 P 置换已经合并进 SP_BOX，查表后按位或即可。
+ * @param r 长度为 32 位的串 R[i - 1]
+ * @param k 长度为 48 位的子密钥 k[i]
+ * @return 32 位输出
+ */
+static des_value_t feistel(des_value_t r, des_value_t k)
+{
+    uint32_t r32 = (uint32_t)r;
+    // clang-format off
+    return SP_BOX[0][(rotl32(r32,  5) ^ (k >> 42)) & 0x3F] |
+           SP_BOX[1][(rotl32(r32,  9) ^ (k >> 36)) & 0x3F] |
+           SP_BOX[2][(rotl32(r32, 13) ^ (k >> 30)) & 0x3F] |
+           SP_BOX[3][(rotl32(r32, 17) ^ (k >> 24)) & 0x3F] |
+           SP_BOX[4][(rotl32(r32, 21) ^ (k >> 18)) & 0x3F] |
+           SP_BOX[5][(rotl32(r32, 25) ^ (k >> 12)) & 0x3F] |
+           SP_BOX[6][(rotl32(r32, 29) ^ (k >>  6)) & 0x3F] |
+           SP_BOX[7][(rotl32(r32,  1) ^ (k >>  0)) & 0x3F];
+    // clang-format on
+}
+
+#endif // DES_REFERENCE
+
+// 为 true 时不使用任何以密钥或数据为下标的查找表，见 des_set_constant_time
+static bool constant_time = false;
+
 /**
  * @brief 生成子密钥
+ * @note PC-1 直接从 64 位密钥中选出 56 位，同时丢弃了奇偶校验位
  * @param key 64 位密钥 K
  * @param subkeys 生成的 16 个 48 位子密钥
  */
@@ -42,18 +90,42 @@ static void calc_subkey(des_value_t key, des_value_t subkeys[16])
 {
     static int SHIFT_BITS[] = {1, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1};
 
-    key = do_permutation(&PERM_REMOVE_PARITY, key);
-    key = do_permutation(&PERM_PC1, key);
+    // 查找表以密钥的各字节为下标，常数时间模式下改为逐位置换
+    key = constant_time ? do_permutation(&PERM_PC1, key) : PERMUTE(PERM_PC1, key);
     des_value_t c = (key >> 28) & 0xFFFFFFF, d = key & 0xFFFFFFF;
     for (int i = 0; i < 16; ++i)
     {
         c = loop_shl(c, 28, SHIFT_BITS[i]);
         d = loop_shl(d, 28, SHIFT_BITS[i]);
         des_value_t cd = (c << 28) | d;
-        subkeys[i] = do_permutation(&PERM_PC2, cd);
+        subkeys[i] = constant_time ? do_permutation(&PERM_PC2, cd) : PERMUTE(PERM_PC2, cd);
+    }
+}
+
+// des_ecb_blocks 使用的位切片实现，为 NULL 时逐块处理
+static const bitslice_backend_t *backend = NULL;
+
+/**
+ * @brief 首次使用时选择当前 CPU 支持的最快的位切片实现
+ * @note 查找表均在编译时生成，见 des_tables.h
+ */
+static void init_tables()
+{
+#ifndef DES_REFERENCE
+    static bool tables_ready = false;
+    if (!tables_ready)
+    {
+        // 没有 SIMD 实现时便携的位切片实现比查表慢，默认逐块查表
+        backend = bitslice_backend(NULL);
+        if (backend && backend->blocks <= BITSLICE_BLOCKS)
+            backend = NULL;
+        tables_ready = true;
     }
+#endif
 }
 
+#ifdef DES_REFERENCE
+
 /**
  * @param m 上一次 T 迭代的结果 M[i-1]=L[i-1]R[i-1]
  * @param k 长度为 48 位的子密钥 k[i]
@@ -65,26 +137,92 @@ static des_value_t t_iteration(des_value_t m, des_value_t k)
     return (r << 32) | (l ^ feistel(r, k));
 }
 
-static des_value_t des_chunk(des_value_t m, des_value_t key, int mode)
+/**
+ * @param m 经过 IP 置换的 64 位块 L[0]R[0]
+ * @param subkeys 按使用顺序排列的 16 个子密钥，解密时即为逆序的加密子密钥
+ * @return 16 次 T 迭代并交换左右两半后的 R[16]L[16]
+ */
+static des_value_t des_rounds(des_value_t m, const des_value_t subkeys[16])
 {
-    // C = E_k(M) = IP^(-1)·W·T_16·...·T_1·IP(M)
-    des_value_t subkeys[16];
-    m = do_permutation(&PERM_IP, m);
-    calc_subkey(key, subkeys);
     for (int i = 0; i < 16; ++i)
-        if (mode == DES_ENCRYPT)
-            m = t_iteration(m, subkeys[i]);
-        else
-            m = t_iteration(m, subkeys[15 - i]);
-    m = do_permutation(&PERM_SWITCH, m);
-    m = do_permutation(&PERM_IPINV, m);
+        m = t_iteration(m, subkeys[i]);
+    return PERMUTE(PERM_SWITCH, m);
+}
+
+/**
+ * @param m 64 位明文块/密文块
+ * @param passes 依次进行的各次 DES 变换的子密钥，单重 DES 时 npasses 为 1
+ */
+static des_value_t des_chunk(des_value_t m, const des_value_t *const passes[], int npasses)
+{
+    // C = E_k(M) = IP^(-1)·W·T_16·...·T_1·IP(M)
+    // 多次 DES 变换时，相邻两次之间的 IP^(-1)·IP 相互抵消
+    m = PERMUTE(PERM_IP, m);
+    for (int p = 0; p < npasses; ++p)
+        m = des_rounds(m, passes[p]);
+    m = PERMUTE(PERM_IPINV, m);
     return m;
 }
 
-static void des_block(char m[], des_value_t key, char c[], int mode)
+#else
+
+// 连续两次 T 迭代：L 和 R 轮流异或上另一半的轮函数结果，交换左右两半只是交换变量的角色
+#define DES_ROUND_PAIR(l, r, subkeys, i) \
+    do                                   \
+    {                                    \
+        l ^= feistel(r, subkeys[i]);     \
+        r ^= feistel(l, subkeys[i + 1]); \
+    } while (0)
+
+/**
+ * @brief 完全展开的 16 次 T 迭代，L、R 分别保存在两个 32 位变量中
+ * @note 每两次迭代后 l、r 恰好回到 L[i]、R[i]，16 次迭代后即为 L[16]、R[16]，不需要逐轮拼接和 PERM_SWITCH。
+ * 加密和解密共用同一份代码：解密时的子密钥在密钥编排中已经逆序存放。
+ * @param subkeys 按使用顺序排列的 16 个子密钥
+ */
+static void des_rounds(uint32_t *l, uint32_t *r, const des_value_t subkeys[16])
+{
+    uint32_t ll = *l, rr = *r;
+    DES_ROUND_PAIR(ll, rr, subkeys, 0);
+    DES_ROUND_PAIR(ll, rr, subkeys, 2);
+    DES_ROUND_PAIR(ll, rr, subkeys, 4);
+    DES_ROUND_PAIR(ll, rr, subkeys, 6);
+    DES_ROUND_PAIR(ll, rr, subkeys, 8);
+    DES_ROUND_PAIR(ll, rr, subkeys, 10);
+    DES_ROUND_PAIR(ll, rr, subkeys, 12);
+    DES_ROUND_PAIR(ll, rr, subkeys, 14);
+    *l = ll;
+    *r = rr;
+}
+
+/**
+ * @param m 64 位明文块/密文块
+ * @param passes 依次进行的各次 DES 变换的子密钥，单重 DES 时 npasses 为 1
+ */
+static des_value_t des_chunk(des_value_t m, const des_value_t *const passes[], int npasses)
+{
+    // C = E_k(M) = IP^(-1)·W·T_16·...·T_1·IP(M)
+    // 多次 DES 变换时，相邻两次之间的 IP^(-1)·IP 相互抵消
+    m = PERMUTE(PERM_IP, m);
+    uint32_t l = m >> 32, r = (uint32_t)m;
+    for (int p = 0; p < npasses; ++p)
+    {
+        des_rounds(&l, &r, passes[p]);
+        // W 交换左右两半，R[16]L[16] 即为下一次 DES 的 L[0]R[0]
+        uint32_t t = l;
+        l = r;
+        r = t;
+    }
+    m = ((des_value_t)l << 32) | r;
+    return PERMUTE(PERM_IPINV, m);
+}
+
+#endif // DES_REFERENCE
+
+static void des_block(const char m[], const des_value_t *const passes[], int npasses, char c[])
 {
-    des_value_t mm = join_uint64(m);
-    des_value_t res = des_chunk(mm, key, mode);
+    des_value_t mm = join_uint64((char *)m);
+    des_value_t res = des_chunk(mm, passes, npasses);
     // clang-format off
     c[0] = (res >> 56) & 0xFF;
     c[1] = (res >> 48) & 0xFF;
@@ -97,111 +235,349 @@ static void des_block(char m[], des_value_t key, char c[], int mode)
     // clang-format on
 }
 
-uint64_t des_generate_key()
+void des_key_schedule(uint64_t key, des_key_schedule_t *schedule)
+{
+    init_tables();
+    schedule->key = key;
+    calc_subkey(key, schedule->subkeys[DES_ENCRYPT]);
+    for (int i = 0; i < 16; ++i)
+        schedule->subkeys[DES_DECRYPT][i] = schedule->subkeys[DES_ENCRYPT][15 - i];
+}
+
+bool des_use_backend(const char *name)
 {
-    char key[8];
-    for (int i = 0; i < 8; ++i)
+    init_tables();
+    if (strcmp(name, "scalar") == 0)
     {
-        key[i] = rand() & 0xFE;
-        key[i] |= count_bits(key[i], 0xFF) % 2 == 1 ? 0 : 1; // odd parity
+        backend = NULL;
+        return true;
     }
-    return join_uint64(key);
+#ifndef DES_REFERENCE
+    const bitslice_backend_t *p = bitslice_backend(name);
+    if (p)
+    {
+        backend = p;
+        return true;
+    }
+#endif
+    return false;
+}
+
+const char *des_backend_name()
+{
+    init_tables();
+    return backend ? backend->name : "scalar";
 }
 
-bool des_verify_key(uint64_t key)
+bool des_set_constant_time(bool enable)
 {
-    char skey[8];
-    split_uint64(key, skey);
-    for (int i = 0; i < 8; ++i)
-        if (count_bits(skey[i], 0xFF) % 2 != 1) // odd parity
-            return false;
+#ifdef DES_REFERENCE
+    return !enable;
+#else
+    constant_time = enable;
     return true;
+#endif
 }
 
-int des(struct des_stream *stream, char m[], int len, uint64_t key, char c[], int clen)
+bool des_constant_time()
 {
-    int olen = 0;
+    return constant_time;
+}
 
-    if (stream->has_buf && stream->mode == DES_DECRYPT)
+/**
+ * @brief 对连续的 nblocks 个块依次做 npasses 次 DES 变换
+ */
+static void crypt_blocks(const des_value_t *const passes[], int npasses, const char in[], char out[], size_t nblocks)
+{
+#ifndef DES_REFERENCE
+    // 先用选定的实现批量处理，不足一批的部分再依次交给更窄的 SIMD 实现，剩余的块逐块查表；
+    // 便携的位切片实现比查表慢，只在被显式选择或常数时间模式下使用。
+    // 常数时间模式下选择 scalar 时也从最窄的位切片实现开始
+    const bitslice_backend_t *first = backend;
+    if (!first && constant_time)
+        for (first = BITSLICE_BACKENDS; first[1].name; ++first)
+            ;
+    const bitslice_backend_t *last = first;
+    for (const bitslice_backend_t *p = first; p && p->name; ++p)
     {
-        if (clen - olen < 8)
-            return -1;
-        memcpy(c + olen, stream->buf, 8);
-        olen += 8;
-        stream->has_buf = false;
+        if (!p->supported() || (!constant_time && p != first && p->blocks <= BITSLICE_BLOCKS))
+            continue;
+        for (; nblocks >= (size_t)p->blocks; nblocks -= p->blocks)
+        {
+            uint64_t blocks[BITSLICE_MAX_BLOCKS];
+            for (int i = 0; i < p->blocks; ++i)
+                blocks[i] = join_uint64((char *)in + i * 8);
+            p->run(passes, npasses, blocks);
+            for (int i = 0; i < p->blocks; ++i)
+                split_uint64(blocks[i], out + i * 8);
+            in += p->blocks * 8;
+            out += p->blocks * 8;
+        }
+        last = p;
     }
 
-    while (stream->len + len >= 8)
+    // 常数时间模式下剩余的块补齐为一批交给最窄的位切片实现，不经过 SP 盒查表
+    if (constant_time && nblocks > 0)
     {
-        memcpy(stream->m + stream->len, m, 8 - stream->len);
-        m += 8 - stream->len;
-        len -= 8 - stream->len;
-        if (clen - olen < 8)
-            return -1;
-        des_block(stream->m, key, c + olen, stream->mode);
-        olen += 8;
-        stream->len = 0;
+        uint64_t blocks[BITSLICE_MAX_BLOCKS];
+        memset(blocks, 0, sizeof(blocks));
+        for (size_t i = 0; i < nblocks; ++i)
+            blocks[i] = join_uint64((char *)in + i * 8);
+        last->run(passes, npasses, blocks);
+        for (size_t i = 0; i < nblocks; ++i)
+            split_uint64(blocks[i], out + i * 8);
+        return;
     }
+#endif
+    for (; nblocks > 0; --nblocks)
+    {
+        des_block(in, passes, npasses, out);
+        in += 8;
+        out += 8;
+    }
+}
+
+void des_ecb_blocks(const des_key_schedule_t *schedule, int mode, const char in[], char out[], size_t nblocks)
+{
+    const des_value_t *passes[1] = {schedule->subkeys[mode]};
+    crypt_blocks(passes, 1, in, out, nblocks);
+}
 
-    if (olen >= 8 && stream->mode == DES_DECRYPT)
+void des3_key_schedule(const uint64_t keys[3], des3_key_schedule_t *schedule)
+{
+    for (int i = 0; i < 3; ++i)
+        des_key_schedule(keys[i], &schedule->keys[i]);
+}
+
+void des3_ecb_blocks(const des3_key_schedule_t *schedule, int mode, const char in[], char out[], size_t nblocks)
+{
+    // 加密 C = E_k3(D_k2(E_k1(M)))，解密 M = D_k1(E_k2(D_k3(C)))
+    const des_value_t *passes[3];
+    for (int i = 0; i < 3; ++i)
     {
-        olen -= 8;
-        memcpy(stream->buf, c + olen, 8);
-        stream->has_buf = true;
+        int key = mode == DES_ENCRYPT ? i : 2 - i;
+        passes[i] = schedule->keys[key].subkeys[(mode + i) % 2];
     }
+    crypt_blocks(passes, 3, in, out, nblocks);
+}
 
+/**
+ * @brief 确保流中缓存的密钥编排对应密钥 key
+ */
+static void ensure_schedule(struct des_stream *stream, uint64_t key)
+{
+    if (!stream->has_schedule || stream->schedule.key != key)
     {
-        memcpy(stream->m + stream->len, m, len);
-        stream->len += len;
+        des_key_schedule(key, &stream->schedule);
+        stream->has_schedule = true;
     }
+}
 
-    return olen;
+int des(struct des_stream *stream, char m[], int len, uint64_t key, char c[], int clen)
+{
+    ensure_schedule(stream, key);
+    return des_update(stream, m, len, c, clen);
 }
 
-struct des_stream *des_open(int mode)
+long des_crypt(struct des_stream *stream, const char m[], size_t len, char c[], size_t clen)
 {
-    struct des_stream *des = (struct des_stream *)malloc(sizeof(struct des_stream));
-    des->len = 0;
-    des->mode = mode;
-    des->has_buf = false;
-    return des;
+    size_t olen = 0;
+    size_t nblocks = (stream->len + len) / 8;
+    if (clen < nblocks * 8)
+        return -1;
+
+    // 先补齐上次缓存的不完整块
+    if (stream->len > 0 && nblocks > 0)
+    {
+        memcpy(stream->m + stream->len, m, 8 - stream->len);
+        m += 8 - stream->len;
+        len -= 8 - stream->len;
+        chain_blocks(stream, stream->m, c, 1);
+        olen += 8;
+        stream->len = 0;
+        --nblocks;
+    }
+
+    // 其余完整的块直接从输入写到输出，m == c 时原地处理
+    chain_blocks(stream, m, c + olen, nblocks);
+    m += nblocks * 8;
+    len -= nblocks * 8;
+    olen += nblocks * 8;
+
+    // 只缓存最后不足一块的部分
+    memcpy(stream->m + stream->len, m, len);
+    stream->len += len;
+    return olen;
 }
 
-int des_close(struct des_stream *stream, uint64_t key, char c[], int clen)
+long des_crypt_final(struct des_stream *stream, const char m[], size_t len, char c[], size_t clen)
 {
-    int ret = 0;
-    if (stream->mode == DES_ENCRYPT)
+    long ret = -1;
+    size_t olen = 0;
+
+    // 由 des_update 保留的最后一个明文块
+    if (stream->has_buf)
+    {
+        if (clen < 8)
+            goto end;
+        memcpy(c, stream->buf, 8);
+        olen += 8;
+        stream->has_buf = false;
+    }
+
+    long n = des_crypt(stream, m, len, c + olen, clen - olen);
+    if (n < 0)
+        goto end;
+    olen += n;
+
+    if (!chain_padded(stream->chaining))
     {
-        ret = 8;
+        // 流模式不需要填充，最后不足一块的部分直接与密钥流异或
+        if (clen - olen < (size_t)stream->len)
+            goto end;
+        chain_tail(stream, stream->m, c + olen, stream->len);
+        olen += stream->len;
+    }
+    else if (stream->mode == DES_ENCRYPT)
+    {
+        if (clen - olen < 8)
+            goto end;
         for (int i = stream->len; i < 8; ++i)
             stream->m[i] = 8 - stream->len;
-        if (clen < ret)
-        {
-            ret = -1;
-            goto end;
-        }
-        des_block(stream->m, key, c, stream->mode);
+        chain_blocks(stream, stream->m, c + olen, 1);
+        olen += 8;
     }
     else
     {
         if (stream->len != 0) // 密文长度必须为 64-bit 的倍数
-        {
-            ret = -1;
             goto end;
-        }
-        if (stream->has_buf)
+        if (olen > 0)
         {
-            int nlen = stream->buf[7];
-            ret = 8 - nlen;
-            if (clen < ret)
-            {
-                ret = -1;
+            // 去除填充，填充长度必须在 1 到 8 之间
+            int pad = (unsigned char)c[olen - 1];
+            if (pad < 1 || pad > 8)
                 goto end;
-            }
-            memcpy(c, stream->buf, ret);
+            olen -= pad;
         }
     }
+    ret = olen;
 end:
     free(stream);
     return ret;
 }
+
+int des_update(struct des_stream *stream, char m[], int len, char c[], int clen)
+{
+    int olen = 0;
+
+    // 需要填充的模式在解密时总是保留最后一个明文块，留待 des_final 去除填充
+    bool holdback = stream->mode == DES_DECRYPT && chain_padded(stream->chaining);
+
+    if (stream->has_buf)
+    {
+        if (clen < 8)
+            return -1;
+        memcpy(c, stream->buf, 8);
+        olen += 8;
+        stream->has_buf = false;
+    }
+
+    long n = des_crypt(stream, m, len, c + olen, clen - olen);
+    if (n < 0)
+        return -1;
+    olen += n;
+
+    if (olen >= 8 && holdback)
+    {
+        olen -= 8;
+        memcpy(stream->buf, c + olen, 8);
+        stream->has_buf = true;
+    }
+    return olen;
+}
+
+static void des_stream_blocks(struct des_stream *stream, int mode, const char in[], char out[], size_t nblocks)
+{
+    des_ecb_blocks(&stream->schedule, mode, in, out, nblocks);
+}
+
+static void des3_stream_blocks(struct des_stream *stream, int mode, const char in[], char out[], size_t nblocks)
+{
+    struct des3_stream *des3 = (struct des3_stream *)stream;
+    des3_ecb_blocks(&des3->schedule, mode, in, out, nblocks);
+}
+
+static void init_stream(struct des_stream *stream, int mode, size_t size)
+{
+    stream->size = size;
+    stream->len = 0;
+    stream->mode = mode;
+    stream->has_buf = false;
+    stream->has_schedule = false;
+    stream->chaining = DES_ECB;
+    stream->blocks = des_stream_blocks;
+}
+
+void des_update_blocks(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    chain_blocks(stream, in, out, nblocks);
+}
+
+struct des_stream *des_open(int mode)
+{
+    struct des_stream *des = (struct des_stream *)malloc(sizeof(struct des_stream));
+    init_stream(des, mode, sizeof(struct des_stream));
+    return des;
+}
+
+struct des_stream *des_clone(const struct des_stream *stream)
+{
+    struct des_stream *des = (struct des_stream *)malloc(stream->size);
+    memcpy(des, stream, stream->size);
+    return des;
+}
+
+void des_set_iv(struct des_stream *stream, int chaining, const char iv[8])
+{
+    stream->chaining = chaining;
+    if (iv)
+        memcpy(stream->iv, iv, 8);
+}
+
+struct des_stream *des_open_schedule(int mode, const des_key_schedule_t *schedule)
+{
+    struct des_stream *des = des_open(mode);
+    des->schedule = *schedule;
+    des->has_schedule = true;
+    return des;
+}
+
+int des_close(struct des_stream *stream, uint64_t key, char c[], int clen)
+{
+    ensure_schedule(stream, key);
+    return des_final(stream, c, clen);
+}
+
+int des_final(struct des_stream *stream, char c[], int clen)
+{
+    return des_crypt_final(stream, NULL, 0, c, clen);
+}
+
+struct des3_stream *des3_open(int mode, const des3_key_schedule_t *schedule)
+{
+    struct des3_stream *des3 = (struct des3_stream *)malloc(sizeof(struct des3_stream));
+    init_stream(&des3->stream, mode, sizeof(struct des3_stream));
+    des3->stream.blocks = des3_stream_blocks;
+    des3->schedule = *schedule;
+    return des3;
+}
+
+int des3(struct des3_stream *stream, char m[], int len, char c[], int clen)
+{
+    return des_update(&stream->stream, m, len, c, clen);
+}
+
+int des3_close(struct des3_stream *stream, char c[], int clen)
+{
+    return des_final(&stream->stream, c, clen);
+}
@@ -0,0 +1,444 @@
+#define _GNU_SOURCE
+#include "fileio.h"
+#include "mode.h"
+#include "parallel.h"
+#include "uring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool write_all(int fd, const char buf[], size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+int mapped_crypt_file(struct des_stream *stream, int infd, int outfd, int threads)
+{
+    struct stat st;
+    if (fstat(infd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+        return 0;
+
+    size_t size = st.st_size;
+    bool padded = chain_padded(stream->chaining);
+    // 输出的最大长度：加密时填充最多增加一个块，解密时只会变短
+    size_t capacity = padded && stream->mode == DES_ENCRYPT ? (size / 8 + 1) * 8 : size;
+    char *in = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, infd, 0);
+    if (in == MAP_FAILED)
+        return 0;
+    char *out = ftruncate(outfd, capacity) == 0
+                    ? (char *)mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, outfd, 0)
+                    : (char *)MAP_FAILED;
+    if (out == MAP_FAILED)
+    {
+        // 输出不是普通文件或者无法映射，恢复为空文件交给流式处理
+        munmap(in, size);
+        if (ftruncate(outfd, 0) != 0 && errno != EINVAL)
+            return -1;
+        return 0;
+    }
+    madvise(in, size, MADV_SEQUENTIAL);
+
+    // 需要填充的模式解密时，最后一个完整块留给 des_crypt_final 去除填充
+    size_t nblocks = size / 8;
+    if (padded && stream->mode == DES_DECRYPT && nblocks > 0)
+        nblocks--;
+    parallel_update_blocks(stream, in, out, nblocks, threads);
+
+    // 尾部直接在映射的内存上完成填充或去除填充
+    size_t offset = nblocks * 8;
+    long flen = des_crypt_final(stream, in + offset, size - offset, out + offset, capacity - offset);
+    int ret = flen >= 0 ? 1 : -1;
+    if (ret > 0)
+        offset += flen;
+
+    munmap(in, size);
+    munmap(out, capacity);
+    if (ret > 0 && ftruncate(outfd, offset) != 0)
+        ret = -1;
+    return ret;
+}
+
+/**
+ * io_uring 流水线中一个缓冲区的状态
+ */
+struct pipeline_buffer
+{
+    char *data;
+    enum
+    {
+        BUFFER_FREE,
+        BUFFER_READING,
+        BUFFER_READY,
+        BUFFER_WRITING
+    } state;
+    // 缓冲区对应的块，块 k 为输入的 [k * bufsize, (k + 1) * bufsize)
+    size_t chunk;
+    // 当前读写请求的总长度和已完成的长度，读写不完整时继续提交剩余部分
+    size_t len;
+    size_t done;
+    off_t offset;
+};
+
+static bool submit_buffer(struct uring *ring, struct pipeline_buffer *buf, int fd, uint64_t id)
+{
+    return uring_prep_rw(ring, buf->state == BUFFER_WRITING, fd, buf->data + buf->done, buf->len - buf->done, buf->offset + buf->done, id);
+}
+
+int uring_crypt_file(struct uring *ring, struct des_stream *stream, int infd, int outfd, size_t bufsize)
+{
+    struct stat inst, outst;
+    if (fstat(infd, &inst) != 0 || !S_ISREG(inst.st_mode) || fstat(outfd, &outst) != 0 || !S_ISREG(outst.st_mode))
+        return 0;
+
+    long page = sysconf(_SC_PAGESIZE);
+    bufsize = (bufsize + page - 1) / page * page;
+
+    // 队列中每个缓冲区最多同时有一个请求
+    size_t size = inst.st_size;
+    size_t nchunks = size == 0 ? 1 : (size + bufsize - 1) / bufsize;
+    int nbuffers = ring->entries < URING_BUFFERS ? ring->entries : URING_BUFFERS;
+    struct pipeline_buffer bufs[URING_BUFFERS];
+    for (int i = 0; i < nbuffers; ++i)
+    {
+        // 最后一块加密时可能增加一个填充块
+        if (posix_memalign((void **)&bufs[i].data, 4096, bufsize + 8) != 0)
+        {
+            while (--i >= 0)
+                free(bufs[i].data);
+            return 0;
+        }
+        bufs[i].state = BUFFER_FREE;
+    }
+
+    size_t next_read = 0, next_crypt = 0;
+    int inflight = 0, ret = 1;
+    while (ret > 0 && (next_crypt < nchunks || inflight > 0))
+    {
+        // 空闲的缓冲区依次读取后面的块
+        for (int i = 0; i < nbuffers && next_read < nchunks; ++i)
+        {
+            struct pipeline_buffer *buf = &bufs[i];
+            if (buf->state != BUFFER_FREE)
+                continue;
+            buf->state = BUFFER_READING;
+            buf->chunk = next_read++;
+            buf->offset = buf->chunk * bufsize;
+            buf->len = size - buf->offset < bufsize ? size - buf->offset : bufsize;
+            buf->done = 0;
+            if (buf->len == 0)
+                buf->state = BUFFER_READY;
+            else if (submit_buffer(ring, buf, infd, i))
+                inflight++;
+            else
+                ret = -1;
+        }
+
+        // 按顺序加密已经读入的块，并提交写请求
+        bool progress = true;
+        while (ret > 0 && progress)
+        {
+            progress = false;
+            for (int i = 0; i < nbuffers; ++i)
+            {
+                struct pipeline_buffer *buf = &bufs[i];
+                if (buf->state != BUFFER_READY || buf->chunk != next_crypt)
+                    continue;
+                long wlen = next_crypt + 1 == nchunks
+                                ? des_crypt_final(stream, buf->data, buf->len, buf->data, bufsize + 8)
+                                : des_crypt(stream, buf->data, buf->len, buf->data, buf->len);
+                if (next_crypt + 1 == nchunks)
+                    stream = NULL;
+                next_crypt++;
+                progress = true;
+                buf->state = BUFFER_WRITING;
+                buf->len = wlen;
+                buf->done = 0;
+                if (wlen < 0)
+                    ret = -1;
+                else if (wlen == 0)
+                    buf->state = BUFFER_FREE;
+                else if (submit_buffer(ring, buf, outfd, i))
+                    inflight++;
+                else
+                    ret = -1;
+            }
+        }
+
+        if (ret < 0 || inflight == 0)
+            continue;
+        if (!uring_wait(ring, 1))
+        {
+            ret = -1;
+            break;
+        }
+        uint64_t id;
+        int res;
+        while (uring_next(ring, &id, &res))
+        {
+            struct pipeline_buffer *buf = &bufs[id];
+            inflight--;
+            if (res <= 0)
+            {
+                ret = -1;
+                continue;
+            }
+            buf->done += res;
+            if (buf->done < buf->len)
+            {
+                // 读写不完整，继续提交剩余部分
+                if (submit_buffer(ring, buf, buf->state == BUFFER_WRITING ? outfd : infd, id))
+                    inflight++;
+                else
+                    ret = -1;
+            }
+            else
+                buf->state = buf->state == BUFFER_READING ? BUFFER_READY : BUFFER_FREE;
+        }
+    }
+
+    // 出错时等待已提交的请求完成后才能释放缓冲区
+    while (inflight > 0 && uring_wait(ring, 1))
+    {
+        uint64_t id;
+        int res;
+        while (uring_next(ring, &id, &res))
+            inflight--;
+    }
+    for (int i = 0; i < nbuffers; ++i)
+        free(bufs[i].data);
+    if (stream)
+        free(stream);
+    return ret;
+}
+
+/**
+ * @brief 读满 size 字节或者直到文件末尾，管道每次 read 可能只返回一部分数据
+ * @param wakefd 不为 -1 时每次读取前同时等待 fd 和 wakefd，wakefd 可读时放弃读取，用于打断阻塞在管道上的读取线程
+ * @return 读取的字节数，出错或被打断时返回 -1
+ */
+static ssize_t read_full(int fd, char buf[], size_t size, int wakefd)
+{
+    size_t len = 0;
+    while (len < size)
+    {
+        if (wakefd >= 0)
+        {
+            struct pollfd fds[2] = {{fd, POLLIN, 0}, {wakefd, POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+            if (fds[1].revents)
+                return -1;
+        }
+        ssize_t n = read(fd, buf + len, size - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        len += n;
+    }
+    return len;
+}
+
+/**
+ * 读取线程与调用线程轮流使用的两个输入缓冲区
+ */
+struct reader
+{
+    int fd;
+    char *bufs[2];
+    size_t size;
+    // full[i] 为 true 时 bufs[i] 中已读入 len[i] 字节，等待调用线程取走；len[i] <= 0 表示文件末尾或出错
+    ssize_t len[2];
+    bool full[2];
+    // 调用线程提前结束时通知读取线程退出，并向 wakeup[1] 写入一个字节打断正在等待输入的读取
+    bool stop;
+    int wakeup[2];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+/**
+ * @brief 读取线程：依次填充两个缓冲区，缓冲区未被取走时等待，读到文件末尾或出错后退出
+ */
+static void *read_worker(void *arg)
+{
+    struct reader *reader = (struct reader *)arg;
+    for (int cur = 0;; cur ^= 1)
+    {
+        pthread_mutex_lock(&reader->lock);
+        while (reader->full[cur] && !reader->stop)
+            pthread_cond_wait(&reader->cond, &reader->lock);
+        bool stop = reader->stop;
+        pthread_mutex_unlock(&reader->lock);
+        if (stop)
+            break;
+
+        ssize_t len = read_full(reader->fd, reader->bufs[cur], reader->size, reader->wakeup[0]);
+
+        pthread_mutex_lock(&reader->lock);
+        reader->len[cur] = len;
+        reader->full[cur] = true;
+        pthread_cond_broadcast(&reader->cond);
+        pthread_mutex_unlock(&reader->lock);
+        if (len <= 0)
+            break;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 等待读取线程填满 bufs[cur]，没有读取线程时直接读取
+ * @return 读取的字节数，文件末尾时返回 0，出错时返回 -1
+ */
+static ssize_t reader_wait(struct reader *reader, bool async, int cur)
+{
+    if (!async)
+        return read_full(reader->fd, reader->bufs[cur], reader->size, -1);
+    pthread_mutex_lock(&reader->lock);
+    while (!reader->full[cur])
+        pthread_cond_wait(&reader->cond, &reader->lock);
+    ssize_t len = reader->len[cur];
+    pthread_mutex_unlock(&reader->lock);
+    return len;
+}
+
+/**
+ * @brief 把用完的 bufs[cur] 交还给读取线程
+ */
+static void reader_release(struct reader *reader, bool async, int cur)
+{
+    if (!async)
+        return;
+    pthread_mutex_lock(&reader->lock);
+    reader->full[cur] = false;
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->lock);
+}
+
+/**
+ * @brief 管道的容量扩大到一个缓冲区，使每次读写都能一次完成，失败时（如超过 pipe-max-size）保持原样
+ */
+static void grow_pipe(int fd, size_t size)
+{
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode))
+        fcntl(fd, F_SETPIPE_SZ, (int)size);
+}
+
+int stream_crypt_file(struct des_stream *stream, int infd, int outfd, size_t bufsize)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    bufsize = (bufsize + page - 1) / page * page;
+    grow_pipe(infd, bufsize);
+    grow_pipe(outfd, bufsize);
+
+    // 整个流只有一个读取线程，它填充一个缓冲区时，调用线程加密另一个缓冲区并写出
+    struct reader reader;
+    reader.fd = infd;
+    reader.bufs[0] = (char *)malloc(bufsize);
+    reader.bufs[1] = (char *)malloc(bufsize);
+    // 需要保留最后一个明文块时的输出缓冲区，以及最后的尾部和填充
+    char *wbuf = (char *)malloc(bufsize + 16);
+    if (!reader.bufs[0] || !reader.bufs[1] || !wbuf)
+    {
+        free(reader.bufs[0]);
+        free(reader.bufs[1]);
+        free(wbuf);
+        free(stream);
+        return -1;
+    }
+    reader.size = bufsize;
+    reader.full[0] = reader.full[1] = false;
+    reader.stop = false;
+    pthread_mutex_init(&reader.lock, NULL);
+    pthread_cond_init(&reader.cond, NULL);
+    // 无法创建唤醒管道或线程时在调用线程中同步读取
+    pthread_t tid;
+    bool async = pipe2(reader.wakeup, O_CLOEXEC) == 0;
+    if (async && pthread_create(&tid, NULL, read_worker, &reader) != 0)
+    {
+        close(reader.wakeup[0]);
+        close(reader.wakeup[1]);
+        async = false;
+    }
+
+    bool holdback = stream->mode == DES_DECRYPT && chain_padded(stream->chaining);
+    int ret = 1;
+
+    for (int cur = 0; ret > 0; cur ^= 1)
+    {
+        char *buf = reader.bufs[cur];
+        ssize_t len = reader_wait(&reader, async, cur);
+        if (len < 0)
+            ret = -1;
+        if (len <= 0)
+            break;
+
+        // 除最后一块外每块都读满了缓冲区，长度为 8 的倍数，因此可以原地加密
+        long wlen;
+        char *out = holdback ? wbuf : buf;
+        if (holdback)
+            wlen = des_update(stream, buf, len, wbuf, bufsize + 8);
+        else
+            wlen = des_crypt(stream, buf, len, buf, len);
+        if (wlen < 0 || !write_all(outfd, out, wlen))
+            ret = -1;
+        reader_release(&reader, async, cur);
+    }
+
+    if (async)
+    {
+        pthread_mutex_lock(&reader.lock);
+        reader.stop = true;
+        pthread_cond_broadcast(&reader.cond);
+        pthread_mutex_unlock(&reader.lock);
+        char byte = 0;
+        while (write(reader.wakeup[1], &byte, 1) < 0 && errno == EINTR)
+            ;
+        pthread_join(tid, NULL);
+        close(reader.wakeup[0]);
+        close(reader.wakeup[1]);
+    }
+    pthread_cond_destroy(&reader.cond);
+    pthread_mutex_destroy(&reader.lock);
+
+    int wlen = des_final(stream, wbuf, bufsize + 16);
+    if (wlen < 0 || (ret > 0 && !write_all(outfd, wbuf, wlen)))
+        ret = -1;
+    free(reader.bufs[0]);
+    free(reader.bufs[1]);
+    free(wbuf);
+    return ret;
+}
+
+int crypt_fds(struct des_stream *stream, int infd, int outfd, struct uring *ring, enum io_method method, int threads, size_t bufsize)
+{
+    int ret = 0;
+    if (ring && (method == IO_AUTO || method == IO_URING))
+        ret = uring_crypt_file(ring, stream, infd, outfd, bufsize);
+    if (ret == 0 && method != IO_STREAM)
+        ret = mapped_crypt_file(stream, infd, outfd, threads);
+    if (ret == 0)
+        ret = stream_crypt_file(stream, infd, outfd, bufsize);
+    return ret;
+}
@@ -0,0 +1,104 @@
+#include "des.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+
+// 把字节的最低位设为奇校验位，即 ODD_PARITY[b] 的高 7 位与 b 相同且 1 的个数为奇数
+static const unsigned char ODD_PARITY[256] = {
+    0x01, 0x01, 0x02, 0x02, 0x04, 0x04, 0x07, 0x07, 0x08, 0x08, 0x0B, 0x0B, 0x0D, 0x0D, 0x0E, 0x0E,
+    0x10, 0x10, 0x13, 0x13, 0x15, 0x15, 0x16, 0x16, 0x19, 0x19, 0x1A, 0x1A, 0x1C, 0x1C, 0x1F, 0x1F,
+    0x20, 0x20, 0x23, 0x23, 0x25, 0x25, 0x26, 0x26, 0x29, 0x29, 0x2A, 0x2A, 0x2C, 0x2C, 0x2F, 0x2F,
+    0x31, 0x31, 0x32, 0x32, 0x34, 0x34, 0x37, 0x37, 0x38, 0x38, 0x3B, 0x3B, 0x3D, 0x3D, 0x3E, 0x3E,
+    0x40, 0x40, 0x43, 0x43, 0x45, 0x45, 0x46, 0x46, 0x49, 0x49, 0x4A, 0x4A, 0x4C, 0x4C, 0x4F, 0x4F,
+    0x51, 0x51, 0x52, 0x52, 0x54, 0x54, 0x57, 0x57, 0x58, 0x58, 0x5B, 0x5B, 0x5D, 0x5D, 0x5E, 0x5E,
+    0x61, 0x61, 0x62, 0x62, 0x64, 0x64, 0x67, 0x67, 0x68, 0x68, 0x6B, 0x6B, 0x6D, 0x6D, 0x6E, 0x6E,
+    0x70, 0x70, 0x73, 0x73, 0x75, 0x75, 0x76, 0x76, 0x79, 0x79, 0x7A, 0x7A, 0x7C, 0x7C, 0x7F, 0x7F,
+    0x80, 0x80, 0x83, 0x83, 0x85, 0x85, 0x86, 0x86, 0x89, 0x89, 0x8A, 0x8A, 0x8C, 0x8C, 0x8F, 0x8F,
+    0x91, 0x91, 0x92, 0x92, 0x94, 0x94, 0x97, 0x97, 0x98, 0x98, 0x9B, 0x9B, 0x9D, 0x9D, 0x9E, 0x9E,
+    0xA1, 0xA1, 0xA2, 0xA2, 0xA4, 0xA4, 0xA7, 0xA7, 0xA8, 0xA8, 0xAB, 0xAB, 0xAD, 0xAD, 0xAE, 0xAE,
+    0xB0, 0xB0, 0xB3, 0xB3, 0xB5, 0xB5, 0xB6, 0xB6, 0xB9, 0xB9, 0xBA, 0xBA, 0xBC, 0xBC, 0xBF, 0xBF,
+    0xC1, 0xC1, 0xC2, 0xC2, 0xC4, 0xC4, 0xC7, 0xC7, 0xC8, 0xC8, 0xCB, 0xCB, 0xCD, 0xCD, 0xCE, 0xCE,
+    0xD0, 0xD0, 0xD3, 0xD3, 0xD5, 0xD5, 0xD6, 0xD6, 0xD9, 0xD9, 0xDA, 0xDA, 0xDC, 0xDC, 0xDF, 0xDF,
+    0xE0, 0xE0, 0xE3, 0xE3, 0xE5, 0xE5, 0xE6, 0xE6, 0xE9, 0xE9, 0xEA, 0xEA, 0xEC, 0xEC, 0xEF, 0xEF,
+    0xF1, 0xF1, 0xF2, 0xF2, 0xF4, 0xF4, 0xF7, 0xF7, 0xF8, 0xF8, 0xFB, 0xFB, 0xFD, 0xFD, 0xFE, 0xFE,
+};
+
+// FIPS 74 列出的 4 个弱密钥和 12 个半弱密钥
+static const uint64_t WEAK_KEYS[] = {
+    0x0101010101010101ULL, 0xFEFEFEFEFEFEFEFEULL, 0xE0E0E0E0F1F1F1F1ULL, 0x1F1F1F1F0E0E0E0EULL,
+    0x01FE01FE01FE01FEULL, 0xFE01FE01FE01FE01ULL, 0x1FE01FE00EF10EF1ULL, 0xE01FE01FF10EF10EULL,
+    0x01E001E001F101F1ULL, 0xE001E001F101F101ULL, 0x1FFE1FFE0EFE0EFEULL, 0xFE1FFE1FFE0EFE0EULL,
+    0x011F011F010E010EULL, 0x1F011F010E010E01ULL, 0xE0FEE0FEF1FEF1FEULL, 0xFEE0FEE0FEF1FEF1ULL,
+};
+
+uint64_t des_set_parity(uint64_t key)
+{
+    uint64_t result = 0;
+    for (int i = 56; i >= 0; i -= 8)
+        result = (result << 8) | ODD_PARITY[(key >> i) & 0xFF];
+    return result;
+}
+
+bool des_verify_key(uint64_t key)
+{
+    return des_set_parity(key) == key;
+}
+
+bool des_weak_key(uint64_t key)
+{
+    for (int i = 0; i < (int)(sizeof(WEAK_KEYS) / sizeof(WEAK_KEYS[0])); ++i)
+        if (key == WEAK_KEYS[i])
+            return true;
+    return false;
+}
+
+/**
+ * @brief 从 getrandom 读取 len 个随机字节，处理被信号中断和一次读不满的情况
+ */
+static bool random_bytes(void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0)
+    {
+        ssize_t n = getrandom(p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool des_generate_keys(uint64_t keys[], size_t n)
+{
+    if (!random_bytes(keys, n * sizeof(uint64_t)))
+        return false;
+
+    // 校验位逐字节设置，与 uint64_t 的字节序无关
+    unsigned char *bytes = (unsigned char *)keys;
+    for (size_t i = 0; i < n * sizeof(uint64_t); ++i)
+        bytes[i] = ODD_PARITY[bytes[i]];
+
+    for (size_t i = 0; i < n; ++i)
+        while (des_weak_key(keys[i]))
+        {
+            if (!random_bytes(&keys[i], sizeof(uint64_t)))
+                return false;
+            keys[i] = des_set_parity(keys[i]);
+        }
+    return true;
+}
+
+uint64_t des_generate_key()
+{
+    uint64_t key;
+    if (!des_generate_keys(&key, 1))
+    {
+        fprintf(stderr, "Unable to read random bytes for DES key\n");
+        abort();
+    }
+    return key;
+}
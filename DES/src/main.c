@@ -1,8 +1,18 @@
 #include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <string.h>
 #include "des.h"
+#include "batch.h"
 #include "binary.h"
+#include "fileio.h"
+#include "selftest.h"
+#include "search.h"
+#include "uring.h"
+#include <fcntl.h>
+#include <unistd.h>
 
 void error(const char *format, ...)
 {
@@ -14,8 +24,107 @@ void error(const char *format, ...)
     exit(2);
 }
 
+// 命令行选项
+struct
+{
+    int chaining;
+    bool has_iv;
+    char iv[8];
+    // 0 表示未指定：加解密使用 1 个线程，搜索密钥使用所有 CPU
+    int threads;
+    const char *checkpoint;
+    // 流式处理时每次读取的字节数
+    size_t buffer;
+    // 普通文件的读写方式
+    enum io_method io;
+} options = {DES_ECB, false, {0}, 0, NULL, 1 << 20, IO_AUTO};
+
+void parse_mode(const char *value)
+{
+    static const char *MODES[] = {"ecb", "cbc", "cfb", "ofb", "ctr"};
+    for (int i = 0; i < (int)(sizeof(MODES) / sizeof(MODES[0])); ++i)
+        if (strcmp(value, MODES[i]) == 0)
+        {
+            options.chaining = i; // 与 DES_ECB ... DES_CTR 的顺序一致
+            return;
+        }
+    error("Unknown mode %s", value);
+}
+
+void parse_iv(const char *value)
+{
+    if (strlen(value) != 16)
+        error("IV must be 16 hex digits");
+    for (int i = 0; i < 8; ++i)
+    {
+        unsigned int byte;
+        if (sscanf(value + i * 2, "%2x", &byte) != 1)
+            error("IV must be 16 hex digits");
+        options.iv[i] = byte;
+    }
+    options.has_iv = true;
+}
+
+void parse_io(const char *value)
+{
+    static const char *METHODS[] = {"auto", "mmap", "uring", "stream"};
+    for (int i = 0; i < (int)(sizeof(METHODS) / sizeof(METHODS[0])); ++i)
+        if (strcmp(value, METHODS[i]) == 0)
+        {
+            options.io = i;
+            return;
+        }
+    error("Unknown I/O method %s", value);
+}
+
+void parse_constant_time(const char *value)
+{
+    if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0)
+        error("--constant-time must be on or off");
+    if (!des_set_constant_time(strcmp(value, "on") == 0))
+        error("Constant-time mode is not available in this build");
+}
+
+void parse_checkpoint(const char *value)
+{
+    options.checkpoint = value;
+}
+
+void parse_buffer(const char *value)
+{
+    char *end;
+    unsigned long long size = strtoull(value, &end, 10);
+    switch (*end)
+    {
+    case 'G':
+    case 'g':
+        size <<= 10;
+        // fall through
+    case 'M':
+    case 'm':
+        size <<= 10;
+        // fall through
+    case 'K':
+    case 'k':
+        size <<= 10;
+        end++;
+    }
+    // des_update 的长度为 int
+    if (*end != '\0' || size < 8 || size > (1ULL << 30))
+        error("Buffer size must be between 8 and 1G, e.g. 4M");
+    options.buffer = size;
+}
+
+void parse_threads(const char *value)
+{
+    options.threads = atoi(value);
+    if (options.threads < 1)
+        error("Number of threads must be positive");
+}
+
 void generate_key(int argc, char *argv[])
 {
+    (void)argc;
     FILE *file = fopen(argv[2], "wb");
     uint64_t key = des_generate_key();
     char raw_key[8];
@@ -27,82 +136,405 @@ void generate_key(int argc, char *argv[])
     fclose(file);
 }
 
-void encrypt(int argc, char *argv[])
+void generate_keys(int argc, char *argv[])
 {
-    FILE *keyfile = fopen(argv[2], "rb");
-    char raw_key[8];
-    if (!keyfile || fread(raw_key, sizeof(unsigned char), DES_KEY_SIZE, keyfile) != DES_KEY_SIZE)
+    (void)argc;
+    long n = atol(argv[2]);
+    if (n <= 0)
+        error("Number of keys must be positive");
+    FILE *file = fopen(argv[3], "wb");
+    if (!file)
+        error("Unable to write keys to given file %s", argv[3]);
+
+    // 每批生成 4096 个密钥，一次读取随机数、一次写入文件
+    enum { BATCH = 4096 };
+    static uint64_t keys[BATCH];
+    static char raw_keys[BATCH * DES_KEY_SIZE];
+    for (long done = 0; done < n; done += BATCH)
     {
-        error("Unable to read key from file %s", argv[2]);
+        size_t count = n - done < BATCH ? n - done : BATCH;
+        if (!des_generate_keys(keys, count))
+            error("Unable to read random bytes");
+        for (size_t i = 0; i < count; ++i)
+            split_uint64(keys[i], raw_keys + i * DES_KEY_SIZE);
+        if (fwrite(raw_keys, DES_KEY_SIZE, count, file) != count)
+            error("Unable to write keys to given file %s", argv[3]);
     }
+    if (fclose(file) != 0)
+        error("Unable to write keys to given file %s", argv[3]);
+}
+
+/**
+ * @brief 从密钥文件中读取至多 n 个连续存放的 DES 密钥，并检查其合法性
+ * @return 读取到的密钥个数；文件长度不是 8 的整数倍（如截断的密钥）或超过 n 个密钥时返回 -1，多余的字节不会被忽略
+ */
+int read_keys(const char *path, uint64_t keys[], int n)
+{
+    FILE *keyfile = fopen(path, "rb");
+    // 多读一个字节以发现超出 n 个密钥的内容
+    char raw_key[8 * 3 + 1];
+    int len = keyfile ? fread(raw_key, sizeof(unsigned char), DES_KEY_SIZE * n + 1, keyfile) : 0;
+    if (!keyfile || ferror(keyfile))
+        error("Unable to read key from file %s", path);
     fclose(keyfile);
-    uint64_t key = join_uint64(raw_key);
-    if (!des_verify_key(key))
-        error("Key in not valid");
-
-    FILE *infile = fopen(argv[3], "rb");
-    if (!infile)
-        error("Unable to open input file %s", argv[3]);
-    FILE *outfile = fopen(argv[4], "wb");
-    if (!outfile)
-        error("Unable to open output file %s", argv[4]);
-
-    struct des_stream *stream = des_open(DES_ENCRYPT);
-
-    char rbuf[1024], wbuf[1024];
-    size_t rlen, wlen;
-    while ((rlen = fread(rbuf, sizeof(char), 1024, infile)))
+    if (len % DES_KEY_SIZE != 0 || len > DES_KEY_SIZE * n)
+        return -1;
+    for (int i = 0; i < len / DES_KEY_SIZE; ++i)
     {
-        wlen = des(stream, rbuf, rlen, key, wbuf, 1024);
-        fwrite(wbuf, sizeof(char), wlen, outfile);
+        keys[i] = join_uint64(raw_key + i * DES_KEY_SIZE);
+        if (!des_verify_key(keys[i]))
+            error("Key in not valid");
     }
+    return len / DES_KEY_SIZE;
+}
 
-    if ((wlen = des_close(stream, key, wbuf, 1024)))
+/**
+ * @brief 读取恰好包含一个 DES 密钥的密钥文件
+ */
+uint64_t read_key(const char *path)
+{
+    uint64_t key;
+    if (read_keys(path, &key, 1) != 1)
+        error("Key file %s must be exactly %d bytes", path, DES_KEY_SIZE);
+    return key;
+}
+
+/**
+ * @brief 获取进程内共用的 io_uring，第一次使用时创建
+ * @return 内核不支持 io_uring 时返回 NULL
+ */
+struct uring *shared_uring()
+{
+    static struct uring ring;
+    static int state = 0; // 0 表示还没有创建，1 表示可用，-1 表示不可用
+    if (state == 0)
+        state = uring_init(&ring, 2 * URING_BUFFERS) ? 1 : -1;
+    return state > 0 ? &ring : NULL;
+}
+
+/**
+ * @brief 将输入文件经过加密流 stream 写入输出文件，并关闭流
+ */
+void crypt_file(struct des_stream *stream, const char *inpath, const char *outpath)
+{
+    if (options.chaining != DES_ECB)
     {
-        fwrite(wbuf, sizeof(char), wlen, outfile);
+        if (!options.has_iv)
+            error("Mode other than ecb requires --iv");
+        des_set_iv(stream, options.chaining, options.iv);
     }
 
-    fclose(infile);
-    fclose(outfile);
+    // "-" 表示标准输入/标准输出
+    bool use_stdin = strcmp(inpath, "-") == 0, use_stdout = strcmp(outpath, "-") == 0;
+    int infd = use_stdin ? STDIN_FILENO : open(inpath, O_RDONLY);
+    if (infd < 0)
+        error("Unable to open input file %s", inpath);
+    int outfd = use_stdout ? STDOUT_FILENO : open(outpath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (outfd < 0)
+        error("Unable to open output file %s", outpath);
+
+    // 普通文件默认单线程时使用 io_uring 流水线，多线程时映射到内存中并行处理；
+    // 标准输入输出、io_uring 或映射不可用时以大缓冲区流式处理
+    struct uring *ring = NULL;
+    if (!use_stdin && !use_stdout && (options.io == IO_URING || (options.io == IO_AUTO && options.threads <= 1)))
+        ring = shared_uring();
+    int ret = crypt_fds(stream, infd, outfd, ring, options.io, options.threads, options.buffer);
+    if (ret < 0)
+        error("Unable to process input file %s", inpath);
+
+    close(infd);
+    close(outfd);
 }
 
-void decrypt(int argc, char *argv[])
+void des_file(char *argv[], int mode)
 {
-    FILE *keyfile = fopen(argv[2], "rb");
-    char raw_key[8];
-    if (!keyfile || fread(raw_key, sizeof(unsigned char), DES_KEY_SIZE, keyfile) != DES_KEY_SIZE)
+    uint64_t key = read_key(argv[2]);
+
+    des_key_schedule_t schedule;
+    des_key_schedule(key, &schedule);
+    crypt_file(des_open_schedule(mode, &schedule), argv[3], argv[4]);
+}
+
+void des3_file(char *argv[], int mode)
+{
+    uint64_t keys[3];
+    int n = read_keys(argv[2], keys, 3);
+    if (n == 2) // EDE2: K3 = K1
+        keys[2] = keys[0];
+    else if (n != 3)
+        error("3DES key file %s must be exactly 16 or 24 bytes (2 or 3 keys)", argv[2]);
+
+    des3_key_schedule_t schedule;
+    des3_key_schedule(keys, &schedule);
+    crypt_file(&des3_open(mode, &schedule)->stream, argv[3], argv[4]);
+}
+
+/**
+ * @brief 加密/解密列表文件中的每个文件，密钥只展开一次
+ * @note 列表每行一个路径，"-" 表示从标准输入读取列表，如 find dir -type f | des encrypt-list key -。
+ * 加密时输出到路径后加 .des 的文件，解密时输出到去掉 .des 后缀的文件。
+ */
+void crypt_list(char *argv[], int mode)
+{
+    uint64_t key = read_key(argv[2]);
+
+    des_key_schedule_t schedule;
+    des_key_schedule(key, &schedule);
+
+    FILE *list = strcmp(argv[3], "-") == 0 ? stdin : fopen(argv[3], "r");
+    if (!list)
+        error("Unable to open list file %s", argv[3]);
+    char inpath[4096], outpath[4096 + 8];
+    while (fgets(inpath, sizeof(inpath), list))
     {
-        error("Unable to read key from file %s", argv[2]);
+        inpath[strcspn(inpath, "\r\n")] = '\0';
+        size_t len = strlen(inpath);
+        if (len == 0)
+            continue;
+        if (mode == DES_ENCRYPT)
+            snprintf(outpath, sizeof(outpath), "%s.des", inpath);
+        else if (len > 4 && strcmp(inpath + len - 4, ".des") == 0)
+            snprintf(outpath, sizeof(outpath), "%.*s", (int)(len - 4), inpath);
+        else
+            error("Encrypted file %s does not end with .des", inpath);
+        crypt_file(des_open_schedule(mode, &schedule), inpath, outpath);
     }
-    fclose(keyfile);
-    uint64_t key = join_uint64(raw_key);
-    if (!des_verify_key(key))
-        error("Key in not valid");
-
-    FILE *infile = fopen(argv[3], "rb");
-    if (!infile)
-        error("Unable to open input file %s", argv[3]);
-    FILE *outfile = fopen(argv[4], "wb");
-    if (!outfile)
-        error("Unable to open output file %s", argv[4]);
-
-    struct des_stream *stream = des_open(DES_DECRYPT);
-
-    char rbuf[1024], wbuf[1024];
-    size_t rlen, wlen;
-    while ((rlen = fread(rbuf, sizeof(char), 1024, infile)))
+    if (list != stdin)
+        fclose(list);
+}
+
+/**
+ * @brief 读取清单文件，每行为以制表符或空格分隔的输入和输出路径，忽略空行和 # 开头的行
+ * @return 文件数，files 需由调用者释放，其中的路径与 files 一同分配
+ */
+int read_manifest(const char *path, struct batch_file **files)
+{
+    FILE *manifest = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!manifest)
+        error("Unable to open manifest file %s", path);
+    int n = 0, capacity = 16;
+    *files = (struct batch_file *)malloc(sizeof(struct batch_file) * capacity);
+    char line[8192];
+    for (int lineno = 1; fgets(line, sizeof(line), manifest); ++lineno)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+        // 有制表符时以制表符分隔，路径中可以包含空格
+        char *sep = strchr(line, '\t');
+        if (!sep)
+            sep = strchr(line, ' ');
+        if (!sep || sep == line || sep[1 + strspn(sep + 1, " \t")] == '\0')
+            error("%s:%d: expected input and output paths", path, lineno);
+        *sep = '\0';
+        char *outpath = sep + 1 + strspn(sep + 1, " \t");
+
+        if (n == capacity)
+            *files = (struct batch_file *)realloc(*files, sizeof(struct batch_file) * (capacity *= 2));
+        struct batch_file *file = &(*files)[n++];
+        memset(file, 0, sizeof(*file));
+        file->inpath = strdup(line);
+        file->outpath = strdup(outpath);
+    }
+    if (manifest != stdin)
+        fclose(manifest);
+    return n;
+}
+
+void batch_progress(const struct batch_task *task, const struct batch_file *file)
+{
+    (void)task;
+    if (file->ret < 0)
+        fprintf(stderr, "%s: %s\n", file->inpath, file->error);
+    else
+        printf("%s -> %s: %zu bytes in %.3f s, %.1f MB/s\n", file->inpath, file->outpath, file->bytes, file->seconds,
+               file->bytes / (file->seconds > 0 ? file->seconds : 1e-9) / (1 << 20));
+}
+
+/**
+ * @brief 按清单在线程池中加密/解密多个文件，密钥只读取和展开一次
+ */
+void crypt_batch(char *argv[], int mode)
+{
+    uint64_t key = read_key(argv[2]);
+    if (options.chaining != DES_ECB && !options.has_iv)
+        error("Mode other than ecb requires --iv");
+
+    des_key_schedule_t schedule;
+    des_key_schedule(key, &schedule);
+
+    struct batch_task task;
+    memset(&task, 0, sizeof(task));
+    task.mode = mode;
+    task.schedule = &schedule;
+    task.chaining = options.chaining;
+    task.iv = options.chaining != DES_ECB ? options.iv : NULL;
+    task.io = options.io;
+    task.buffer = options.buffer;
+    task.nfiles = read_manifest(argv[3], &task.files);
+    task.threads = options.threads > 0 ? options.threads : sysconf(_SC_NPROCESSORS_ONLN);
+    task.done = batch_progress;
+
+    int failures = batch_crypt(&task);
+    size_t total = 0;
+    for (int i = 0; i < task.nfiles; ++i)
     {
-        wlen = des(stream, rbuf, rlen, key, wbuf, 1024);
-        fwrite(wbuf, sizeof(char), wlen, outfile);
+        if (task.files[i].ret > 0)
+            total += task.files[i].bytes;
+        free((char *)task.files[i].inpath);
+        free((char *)task.files[i].outpath);
     }
+    free(task.files);
+    printf("%d files, %zu bytes in %.3f s on %d threads, %.1f MB/s\n", task.nfiles - failures, total, task.seconds, task.threads,
+           total / (task.seconds > 0 ? task.seconds : 1e-9) / (1 << 20));
+    if (failures > 0)
+        error("%d files failed", failures);
+}
+
+void encrypt(int argc, char *argv[])
+{
+    (void)argc;
+    des_file(argv, DES_ENCRYPT);
+}
+
+void decrypt(int argc, char *argv[])
+{
+    (void)argc;
+    des_file(argv, DES_DECRYPT);
+}
+
+void encrypt3(int argc, char *argv[])
+{
+    (void)argc;
+    des3_file(argv, DES_ENCRYPT);
+}
+
+void decrypt3(int argc, char *argv[])
+{
+    (void)argc;
+    des3_file(argv, DES_DECRYPT);
+}
+
+void encrypt_list(int argc, char *argv[])
+{
+    (void)argc;
+    crypt_list(argv, DES_ENCRYPT);
+}
+
+void decrypt_list(int argc, char *argv[])
+{
+    (void)argc;
+    crypt_list(argv, DES_DECRYPT);
+}
+
+void encrypt_batch(int argc, char *argv[])
+{
+    (void)argc;
+    crypt_batch(argv, DES_ENCRYPT);
+}
+
+void decrypt_batch(int argc, char *argv[])
+{
+    (void)argc;
+    crypt_batch(argv, DES_DECRYPT);
+}
 
-    if ((wlen = des_close(stream, key, wbuf, 1024)))
+void selftest(int argc, char *argv[])
+{
+    unsigned int seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+    int failures = des_selftest(seed);
+    if (failures > 0)
+        error("%d self-tests failed", failures);
+    printf("All self-tests passed\n");
+}
+
+/**
+ * @brief 解析 16 位十六进制数
+ */
+uint64_t parse_hex64(const char *value, const char *name)
+{
+    uint64_t result;
+    if (strlen(value) != 16 || sscanf(value, "%16" SCNx64, &result) != 1)
+        error("%s must be 16 hex digits", name);
+    return result;
+}
+
+/**
+ * @brief 解析密钥搜索范围的端点，为不超过 2^56 的十六进制数
+ */
+uint64_t parse_key_index(const char *value, const char *name)
+{
+    char *end;
+    errno = 0;
+    uint64_t result = strtoull(value, &end, 16);
+    // strtoull 会跳过前导空白并接受负号，这里只接受十六进制数字开头的数
+    if (!isxdigit((unsigned char)value[0]) || *end != '\0' || errno == ERANGE || result > 1ULL << 56)
+        error("%s must be a hex number within [0, 100000000000000]", name);
+    return result;
+}
+
+// 命令行指定的搜索起点，与终点一起写入断点文件，续搜时核对范围
+uint64_t search_first;
+
+/**
+ * @brief 把搜索进度写入断点文件，先写临时文件再改名，中途退出时不会留下不完整的文件
+ * @note 每行依次为明文、密文、请求的范围 [first, end) 和下一个要搜索的下标
+ */
+void write_checkpoint(const struct search_task *task)
+{
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", options.checkpoint);
+    FILE *file = fopen(tmp, "w");
+    if (!file)
+        error("Unable to write checkpoint file %s", tmp);
+    fprintf(file, "%016" PRIx64 " %016" PRIx64 " %014" PRIx64 " %014" PRIx64 " %014" PRIx64 "\n", task->plain, task->cipher, search_first,
+            task->end, task->next);
+    if (fclose(file) != 0 || rename(tmp, options.checkpoint) != 0)
+        error("Unable to write checkpoint file %s", options.checkpoint);
+}
+
+void search_progress(const struct search_task *task, uint64_t searched, double keys_per_second)
+{
+    fprintf(stderr, "searched %" PRIu64 " keys, %.0f keys/s, next %014" PRIx64 "\n", searched, keys_per_second, task->next);
+    if (options.checkpoint)
+        write_checkpoint(task);
+}
+
+void search(int argc, char *argv[])
+{
+    struct search_task task;
+    task.plain = parse_hex64(argv[2], "Plaintext");
+    task.cipher = parse_hex64(argv[3], "Ciphertext");
+    task.next = argc > 4 ? parse_key_index(argv[4], "First key index") : 0;
+    task.end = argc > 5 ? parse_key_index(argv[5], "End key index") : 1ULL << 56;
+    task.threads = options.threads > 0 ? options.threads : sysconf(_SC_NPROCESSORS_ONLN);
+    task.progress = search_progress;
+    if (task.next > task.end)
+        error("Key range must be within [0, 100000000000000)");
+    search_first = task.next;
+
+    // 断点文件存在且记录的是同一次搜索时，从中记录的位置继续搜索
+    FILE *file = options.checkpoint ? fopen(options.checkpoint, "r") : NULL;
+    if (file)
     {
-        fwrite(wbuf, sizeof(char), wlen, outfile);
+        uint64_t plain, cipher, first, end, next;
+        if (fscanf(file, "%" SCNx64 " %" SCNx64 " %" SCNx64 " %" SCNx64 " %" SCNx64, &plain, &cipher, &first, &end, &next) != 5 ||
+            next < first || next > end)
+            error("Invalid checkpoint file %s", options.checkpoint);
+        fclose(file);
+        if (plain != task.plain || cipher != task.cipher)
+            error("Checkpoint file %s belongs to another plaintext/ciphertext pair", options.checkpoint);
+        if (first != task.next || end != task.end)
+            error("Checkpoint file %s belongs to another key range [%014" PRIx64 ", %014" PRIx64 ")", options.checkpoint, first, end);
+        task.next = next;
     }
 
-    fclose(infile);
-    fclose(outfile);
+    fprintf(stderr, "searching keys [%014" PRIx64 ", %014" PRIx64 ") with %s on %d threads\n", task.next, task.end, des_backend_name(), task.threads);
+    search_keys(&task);
+    for (int i = 0; i < task.nfound; ++i)
+        printf("%016" PRIx64 "\n", task.found[i]);
+    if (task.nfound == 0)
+        error("Key not found");
 }
 
 struct optaction
@@ -115,12 +547,64 @@ struct optaction
 
 struct optaction actions[] = {
     {"generate-key", 1, "[key file]: generate a vaild DES key to given file", generate_key},
+    {"generate-keys", 2, "[N] [key file]: generate N valid DES keys, 8 bytes each, to given file", generate_keys},
     {"encrypt", 3, "[key file] [plain file] [cipher file]: encrypt given input file by DES key", encrypt},
     {"decrypt", 3, "[key file] [cipher file] [decrypted file]: decrypte given file by DES key", decrypt},
+    {"encrypt3", 3, "[key file] [plain file] [cipher file]: encrypt given input file by 3DES EDE, key file contains 2 or 3 DES keys", encrypt3},
+    {"decrypt3", 3, "[key file] [cipher file] [decrypted file]: decrypt given file by 3DES EDE, key file contains 2 or 3 DES keys", decrypt3},
+    {"encrypt-list", 2, "[key file] [list file]: encrypt every file listed one per line (\"-\" reads the list from stdin) to file.des", encrypt_list},
+    {"decrypt-list", 2, "[key file] [list file]: decrypt every file.des listed one per line (\"-\" reads the list from stdin) to file", decrypt_list},
+    {"encrypt-batch", 2, "[key file] [manifest]: encrypt the input/output path pairs listed one per line on a worker pool, reporting throughput", encrypt_batch},
+    {"decrypt-batch", 2, "[key file] [manifest]: decrypt the input/output path pairs listed one per line on a worker pool, reporting throughput", decrypt_batch},
+    {"search", 2, "[plain hex] [cipher hex] [first] [end]: search the 56-bit key index range [first, end) in hex (default all keys) for the key encrypting plain to cipher", search},
+    {"selftest", 0, "[seed]: run known-answer and randomized tests on every supported implementation", selftest},
     {NULL, 0, NULL, NULL}};
 
+struct optflag
+{
+    const char *opt;
+    const char *help;
+    void (*parse)(const char *);
+};
+
+struct optflag flags[] = {
+    {"--mode", "[ecb|cbc|cfb|ofb|ctr]: block cipher mode, default ecb; cfb, ofb and ctr do not pad", parse_mode},
+    {"--iv", "[16 hex digits]: initial vector, or initial counter for ctr", parse_iv},
+    {"--threads", "[N]: process regular files on N threads in ecb, ctr, cbc/cfb decryption; batch and search use all CPUs by default", parse_threads},
+    {"--buffer", "[size]: read size for pipes and stdin/stdout (\"-\" as file name), e.g. 4M, default 1M", parse_buffer},
+    {"--io", "[auto|mmap|uring|stream]: how regular files are read and written, default io_uring on one thread and mmap on more, falling back to mmap and then stream", parse_io},
+    {"--constant-time", "[on|off]: evaluate every block with the bitsliced kernels and expand keys without lookup tables, default off", parse_constant_time},
+    {"--checkpoint", "[file]: save search progress to file every second and resume from it when searching the same pair and key range", parse_checkpoint},
+    {NULL, NULL, NULL}};
+
+/**
+ * @brief 解析 argv 中的选项，并将其从 argv 中移除
+ * @return 移除选项后的参数个数
+ */
+int parse_flags(int argc, char *argv[])
+{
+    int n = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        struct optflag *p = flags;
+        while (p->opt && strcmp(argv[i], p->opt) != 0)
+            p++;
+        if (!p->opt)
+        {
+            argv[n++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc)
+            error("Option %s requires a value", p->opt);
+        p->parse(argv[++i]);
+    }
+    argv[n] = NULL;
+    return n;
+}
+
 void usage(int argc, char *argv[])
 {
+    (void)argc;
     fprintf(stderr, "DES encryption and decryption\n");
     fprintf(stderr, "Usage: %s [command] [options...]\n\n", argv[0]);
     fprintf(stderr, "Commands:\n");
@@ -128,10 +612,16 @@ void usage(int argc, char *argv[])
     {
         fprintf(stderr, "  %s %s\n", p->opt, p->help);
     }
+    fprintf(stderr, "\nOptions:\n");
+    for (struct optflag *p = flags; p->opt; p++)
+    {
+        fprintf(stderr, "  %s %s\n", p->opt, p->help);
+    }
 }
 
 int main(int argc, char *argv[])
 {
+    argc = parse_flags(argc, argv);
     if (argc < 2)
     {
         usage(argc, argv);
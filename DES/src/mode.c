@@ -0,0 +1,156 @@
+#include "mode.h"
+#include "binary.h"
+#include <string.h>
+
+// 可以并行的模式每次批量处理的块数
+#define CHAIN_BATCH 512
+
+static void xor_bytes(char out[], const char a[], const char b[], int len)
+{
+    for (int i = 0; i < len; ++i)
+        out[i] = a[i] ^ b[i];
+}
+
+bool chain_padded(int chaining)
+{
+    return chaining == DES_ECB || chaining == DES_CBC;
+}
+
+/**
+ * @brief CBC 加密：C[i] = E(P[i] ^ C[i-1])，只能逐块进行
+ */
+static void cbc_encrypt(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    for (; nblocks > 0; --nblocks, in += 8, out += 8)
+    {
+        char t[8];
+        xor_bytes(t, in, stream->iv, 8);
+        stream->blocks(stream, DES_ENCRYPT, t, out, 1);
+        memcpy(stream->iv, out, 8);
+    }
+}
+
+/**
+ * @brief CBC 解密：P[i] = D(C[i]) ^ C[i-1]，先批量解密，再从后往前异或以允许 in 和 out 相同
+ */
+static void cbc_decrypt(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    char tmp[CHAIN_BATCH * 8], next_iv[8];
+    while (nblocks > 0)
+    {
+        int n = nblocks < CHAIN_BATCH ? nblocks : CHAIN_BATCH;
+        memcpy(next_iv, in + (n - 1) * 8, 8);
+        stream->blocks(stream, DES_DECRYPT, in, tmp, n);
+        for (int i = n - 1; i >= 0; --i)
+            xor_bytes(out + i * 8, tmp + i * 8, i > 0 ? in + (i - 1) * 8 : stream->iv, 8);
+        memcpy(stream->iv, next_iv, 8);
+        in += n * 8;
+        out += n * 8;
+        nblocks -= n;
+    }
+}
+
+/**
+ * @brief CFB 加密：C[i] = P[i] ^ E(C[i-1])，只能逐块进行
+ */
+static void cfb_encrypt(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    for (; nblocks > 0; --nblocks, in += 8, out += 8)
+    {
+        char t[8];
+        stream->blocks(stream, DES_ENCRYPT, stream->iv, t, 1);
+        xor_bytes(out, in, t, 8);
+        memcpy(stream->iv, out, 8);
+    }
+}
+
+/**
+ * @brief CFB 解密：P[i] = C[i] ^ E(C[i-1])，所有 E(C[i-1]) 可以批量计算
+ */
+static void cfb_decrypt(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    char tmp[CHAIN_BATCH * 8];
+    while (nblocks > 0)
+    {
+        int n = nblocks < CHAIN_BATCH ? nblocks : CHAIN_BATCH;
+        memcpy(tmp, stream->iv, 8);
+        memcpy(tmp + 8, in, (n - 1) * 8);
+        memcpy(stream->iv, in + (n - 1) * 8, 8);
+        stream->blocks(stream, DES_ENCRYPT, tmp, tmp, n);
+        xor_bytes(out, in, tmp, n * 8);
+        in += n * 8;
+        out += n * 8;
+        nblocks -= n;
+    }
+}
+
+/**
+ * @brief OFB：O[i] = E(O[i-1])，C[i] = P[i] ^ O[i]，密钥流只能逐块生成
+ */
+static void ofb(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    for (; nblocks > 0; --nblocks, in += 8, out += 8)
+    {
+        stream->blocks(stream, DES_ENCRYPT, stream->iv, stream->iv, 1);
+        xor_bytes(out, in, stream->iv, 8);
+    }
+}
+
+/**
+ * @brief CTR：C[i] = P[i] ^ E(IV + i)，IV 视为 64 位大端整数，所有计数器块可以批量加密
+ */
+static void ctr(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    char tmp[CHAIN_BATCH * 8];
+    while (nblocks > 0)
+    {
+        int n = nblocks < CHAIN_BATCH ? nblocks : CHAIN_BATCH;
+        uint64_t counter = join_uint64(stream->iv);
+        for (int i = 0; i < n; ++i)
+            split_uint64(counter + i, tmp + i * 8);
+        split_uint64(counter + n, stream->iv);
+        stream->blocks(stream, DES_ENCRYPT, tmp, tmp, n);
+        xor_bytes(out, in, tmp, n * 8);
+        in += n * 8;
+        out += n * 8;
+        nblocks -= n;
+    }
+}
+
+void chain_blocks(struct des_stream *stream, const char in[], char out[], size_t nblocks)
+{
+    if (nblocks == 0)
+        return;
+    switch (stream->chaining)
+    {
+    case DES_CBC:
+        if (stream->mode == DES_ENCRYPT)
+            cbc_encrypt(stream, in, out, nblocks);
+        else
+            cbc_decrypt(stream, in, out, nblocks);
+        break;
+    case DES_CFB:
+        if (stream->mode == DES_ENCRYPT)
+            cfb_encrypt(stream, in, out, nblocks);
+        else
+            cfb_decrypt(stream, in, out, nblocks);
+        break;
+    case DES_OFB:
+        ofb(stream, in, out, nblocks);
+        break;
+    case DES_CTR:
+        ctr(stream, in, out, nblocks);
+        break;
+    default:
+        stream->blocks(stream, stream->mode, in, out, nblocks);
+        break;
+    }
+}
+
+void chain_tail(struct des_stream *stream, const char in[], char out[], int len)
+{
+    // 三种流模式的下一个密钥流块都是 E(IV)：CFB 的 IV 为上一个密文块，OFB 为上一个输出块，CTR 为计数器
+    char t[8];
+    stream->blocks(stream, DES_ENCRYPT, stream->iv, t, 1);
+    xor_bytes(out, in, t, len);
+}
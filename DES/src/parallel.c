@@ -0,0 +1,115 @@
+#include "parallel.h"
+#include "binary.h"
+#include <pthread.h>
+#include <string.h>
+
+// 每个工作线程每次处理的段大小（块数），即 4 MiB
+#define SEGMENT_BLOCKS ((4 << 20) / 8)
+
+struct job
+{
+    const struct des_stream *stream;
+    const char *in;
+    char *out;
+    size_t nblocks;
+    // 每一段开始时流中的 IV
+    char (*ivs)[8];
+    // 下一个待领取的段
+    size_t next;
+    pthread_mutex_t lock;
+};
+
+static bool parallel_mode(const struct des_stream *stream)
+{
+    switch (stream->chaining)
+    {
+    case DES_ECB:
+    case DES_CTR:
+        return true;
+    case DES_CBC:
+    case DES_CFB:
+        return stream->mode == DES_DECRYPT;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief 计算从第 block 块开始处理时流中的 IV
+ * @note CTR 的计数器为初始值加上 block，CBC、CFB 为输入中的前一个密文块
+ */
+static void block_iv(const struct des_stream *stream, const char in[], size_t block, char iv[8])
+{
+    memcpy(iv, stream->iv, 8);
+    if (block == 0)
+        return;
+    if (stream->chaining == DES_CTR)
+        split_uint64(join_uint64(iv) + block, iv);
+    else if (stream->chaining == DES_CBC || stream->chaining == DES_CFB)
+        memcpy(iv, in + (block - 1) * 8, 8);
+}
+
+static void *worker(void *arg)
+{
+    struct job *job = (struct job *)arg;
+    struct des_stream *stream = des_clone(job->stream);
+
+    while (true)
+    {
+        pthread_mutex_lock(&job->lock);
+        size_t segment = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        size_t first = segment * SEGMENT_BLOCKS;
+        if (first >= job->nblocks)
+            break;
+        size_t n = job->nblocks - first < SEGMENT_BLOCKS ? job->nblocks - first : SEGMENT_BLOCKS;
+        des_set_iv(stream, stream->chaining, job->ivs[segment]);
+        des_update_blocks(stream, job->in + first * 8, job->out + first * 8, n);
+    }
+
+    free(stream);
+    return NULL;
+}
+
+void parallel_update_blocks(struct des_stream *stream, const char in[], char out[], size_t nblocks, int threads)
+{
+    size_t nsegments = (nblocks + SEGMENT_BLOCKS - 1) / SEGMENT_BLOCKS;
+    if (threads <= 1 || nsegments <= 1 || !parallel_mode(stream))
+    {
+        des_update_blocks(stream, in, out, nblocks);
+        return;
+    }
+
+    struct job job;
+    job.stream = stream;
+    job.in = in;
+    job.out = out;
+    job.nblocks = nblocks;
+    job.next = 0;
+    job.ivs = (char(*)[8])malloc(nsegments * 8);
+    for (size_t i = 0; i < nsegments; ++i)
+        block_iv(stream, in, i * SEGMENT_BLOCKS, job.ivs[i]);
+    // 处理之后流中的 IV，需要在 in 被覆盖之前取出
+    char iv[8];
+    block_iv(stream, in, nblocks, iv);
+    pthread_mutex_init(&job.lock, NULL);
+
+    if ((size_t)threads > nsegments)
+        threads = nsegments;
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    int started = 0;
+    for (; started < threads; ++started)
+        if (pthread_create(&tids[started], NULL, worker, &job) != 0)
+            break;
+    // 无法创建线程时由调用线程完成剩下的段
+    if (started < threads)
+        worker(&job);
+    for (int i = 0; i < started; ++i)
+        pthread_join(tids[i], NULL);
+
+    free(tids);
+    free(job.ivs);
+    pthread_mutex_destroy(&job.lock);
+    des_set_iv(stream, stream->chaining, iv);
+}
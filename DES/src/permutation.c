@@ -12,9 +12,42 @@ uint64_t do_permutation(const permutation_t *perm, uint64_t chunk)
     return result;
 }
 
+void compile_permutation(const permutation_t *perm, permutation_lut_t *lut)
+{
+    lut->from_bytes = (perm->from_bits + 7) / 8;
+    for (int i = 0; i < 8; ++i)
+        for (int b = 0; b < 256; ++b)
+            lut->table[i][b] = 0;
+    for (int i = 0; i < perm->to_bits; ++i)
+    {
+        int from = perm->from_bits - perm->table[i] - 1;
+        uint64_t to = (uint64_t)1 << (perm->to_bits - i - 1);
+        for (int b = 0; b < 256; ++b)
+            if (get_bit(b, from % 8))
+                lut->table[from / 8][b] |= to;
+    }
+}
+
+bool check_permutation_lut(const permutation_t *perm, const permutation_lut_t *lut)
+{
+    for (int i = 0; i < lut->from_bytes; ++i)
+        for (int b = 0; b < 256; ++b)
+            if (lut->table[i][b] != do_permutation(perm, (uint64_t)b << (i * 8)))
+                return false;
+    return true;
+}
+
+uint64_t do_permutation_lut(const permutation_lut_t *lut, uint64_t chunk)
+{
+    uint64_t result = 0;
+    for (int i = 0; i < lut->from_bytes; ++i)
+        result |= lut->table[i][(chunk >> (i * 8)) & 0xFF];
+    return result;
+}
+
 uint64_t do_sbox(const int box[4][16], uint64_t chunk)
 {
-    assert(0 <= chunk && chunk < (1 << 6));
+    assert(chunk < (1 << 6));
     return box[((chunk >> 4) & 0x2) | (chunk & 0x1)][(chunk >> 1) & 0xF];
 }
 
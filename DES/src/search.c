@@ -0,0 +1,214 @@
+#include "search.h"
+#include "bitslice.h"
+#include "binary.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// 每个工作线程每次领取的密钥数
+#define SEGMENT_KEYS (1 << 20)
+
+struct job
+{
+    struct search_task *task;
+    const bitslice_backend_t *backend;
+    // 下一个待领取的段的起始下标
+    uint64_t next;
+    // 各线程正在处理的段的起始下标，空闲时为 UINT64_MAX
+    uint64_t *current;
+    uint64_t searched;
+    int running;
+    bool stop;
+    pthread_mutex_t lock;
+};
+
+struct worker_arg
+{
+    struct job *job;
+    int id;
+};
+
+uint64_t search_key(uint64_t index)
+{
+    uint64_t key = 0;
+    for (int i = 7; i >= 0; --i)
+        key = (key << 8) | (((index >> (7 * i)) & 0x7F) << 1);
+    return des_set_parity(key);
+}
+
+static void record_found(struct job *job, uint64_t key)
+{
+    pthread_mutex_lock(&job->lock);
+    struct search_task *task = job->task;
+    if (task->nfound < SEARCH_MAX_FOUND)
+        task->found[task->nfound++] = key;
+    job->stop = true;
+    pthread_mutex_unlock(&job->lock);
+}
+
+/**
+ * @brief 检查下标在 [first, last) 中的密钥
+ */
+static void search_segment(struct job *job, uint64_t first, uint64_t last)
+{
+    const struct search_task *task = job->task;
+    const bitslice_backend_t *backend = job->backend;
+
+    if (!backend)
+    {
+        char plain[8], cipher[8];
+        split_uint64(task->plain, plain);
+        for (uint64_t i = first; i < last; ++i)
+        {
+            des_key_schedule_t schedule;
+            des_key_schedule(search_key(i), &schedule);
+            des_ecb_blocks(&schedule, DES_ENCRYPT, plain, cipher, 1);
+            if (join_uint64(cipher) == task->cipher)
+                record_found(job, search_key(i));
+        }
+        return;
+    }
+
+    uint64_t keys[BITSLICE_MAX_BLOCKS], match[BITSLICE_MAX_BLOCKS / 64];
+    for (uint64_t base = first; base < last; base += backend->blocks)
+    {
+        // 最后不足一批时重复最后一个密钥补齐，匹配时只记录一次
+        for (int j = 0; j < backend->blocks; ++j)
+            keys[j] = search_key(base + j < last ? base + j : last - 1);
+        backend->search(keys, task->plain, task->cipher, match);
+        for (int g = 0; g < backend->blocks / 64; ++g)
+            for (int j = 0; match[g] && j < 64; ++j)
+                if (((match[g] >> j) & 1) && base + g * 64 + j < last)
+                    record_found(job, keys[g * 64 + j]);
+    }
+}
+
+static void *worker(void *arg)
+{
+    struct job *job = ((struct worker_arg *)arg)->job;
+    int id = ((struct worker_arg *)arg)->id;
+    uint64_t end = job->task->end;
+
+    while (true)
+    {
+        pthread_mutex_lock(&job->lock);
+        uint64_t first = job->next;
+        bool done = job->stop || first >= end;
+        if (!done)
+        {
+            job->next = end - first < SEGMENT_KEYS ? end : first + SEGMENT_KEYS;
+            job->current[id] = first;
+        }
+        pthread_mutex_unlock(&job->lock);
+        if (done)
+            break;
+
+        uint64_t last = end - first < SEGMENT_KEYS ? end : first + SEGMENT_KEYS;
+        search_segment(job, first, last);
+
+        pthread_mutex_lock(&job->lock);
+        job->current[id] = UINT64_MAX;
+        job->searched += last - first;
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->running--;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/**
+ * @brief 更新 task->next 为尚未完成的最小下标
+ * @note 段按顺序领取，而每个线程完成手上的段后才领取下一段，因此小于所有正在处理的段的下标都已完成
+ */
+static void update_next(struct job *job, int threads)
+{
+    uint64_t next = job->next;
+    for (int i = 0; i < threads; ++i)
+        if (job->current[i] < next)
+            next = job->current[i];
+    job->task->next = next;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+uint64_t search_keys(struct search_task *task)
+{
+    struct job job;
+    job.task = task;
+#ifdef DES_REFERENCE
+    job.backend = NULL;
+#else
+    const char *name = des_backend_name();
+    // 一次试验 64 个密钥的便携位切片实现比逐个生成编排快，des_ecb_blocks 逐块查表时也使用它
+    job.backend = bitslice_backend(strcmp(name, "scalar") == 0 ? "bitslice" : name);
+#endif
+    job.next = task->next;
+    job.searched = 0;
+    job.stop = false;
+    pthread_mutex_init(&job.lock, NULL);
+    task->nfound = 0;
+
+    int threads = task->threads > 0 ? task->threads : 1;
+    job.current = (uint64_t *)malloc(sizeof(uint64_t) * threads);
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    struct worker_arg *args = (struct worker_arg *)malloc(sizeof(struct worker_arg) * threads);
+    job.running = threads;
+    for (int i = 0; i < threads; ++i)
+    {
+        job.current[i] = UINT64_MAX;
+        args[i].job = &job;
+        args[i].id = i;
+    }
+
+    // 线程创建失败时，由调用线程完成剩余的工作
+    int started = 0;
+    for (; started < threads; ++started)
+        if (pthread_create(&tids[started], NULL, worker, &args[started]) != 0)
+            break;
+    if (started < threads)
+    {
+        // 未创建的线程不会减少 running，调用线程本身的 worker 结束时会减少一次
+        pthread_mutex_lock(&job.lock);
+        job.running -= threads - started - 1;
+        pthread_mutex_unlock(&job.lock);
+        worker(&args[started]);
+    }
+
+    double last_time = now();
+    uint64_t last_searched = 0;
+    while (true)
+    {
+        usleep(100000);
+        pthread_mutex_lock(&job.lock);
+        bool finished = job.running == 0;
+        update_next(&job, threads);
+        uint64_t searched = job.searched;
+        pthread_mutex_unlock(&job.lock);
+
+        double t = now();
+        if (task->progress && (finished || t - last_time >= 1))
+        {
+            task->progress(task, searched, (searched - last_searched) / (t - last_time));
+            last_time = t;
+            last_searched = searched;
+        }
+        if (finished)
+            break;
+    }
+
+    for (int i = 0; i < started; ++i)
+        pthread_join(tids[i], NULL);
+    pthread_mutex_destroy(&job.lock);
+    free(tids);
+    free(args);
+    free(job.current);
+    return job.searched;
+}
@@ -0,0 +1,412 @@
+#include "selftest.h"
+#include "des.h"
+#include "binary.h"
+#include "bitslice.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 单位明文测试：密钥为 0101010101010101，明文只有自高位起第 i 位为 1 时的密文
+static const uint64_t VARIABLE_PLAINTEXT[64] = {
+    0x95F8A5E5DD31D900ULL, 0xDD7F121CA5015619ULL, 0x2E8653104F3834EAULL, 0x4BD388FF6CD81D4FULL,
+    0x20B9E767B2FB1456ULL, 0x55579380D77138EFULL, 0x6CC5DEFAAF04512FULL, 0x0D9F279BA5D87260ULL,
+    0xD9031B0271BD5A0AULL, 0x424250B37C3DD951ULL, 0xB8061B7ECD9A21E5ULL, 0xF15D0F286B65BD28ULL,
+    0xADD0CC8D6E5DEBA1ULL, 0xE6D5F82752AD63D1ULL, 0xECBFE3BD3F591A5EULL, 0xF356834379D165CDULL,
+    0x2B9F982F20037FA9ULL, 0x889DE068A16F0BE6ULL, 0xE19E275D846A1298ULL, 0x329A8ED523D71AECULL,
+    0xE7FCE22557D23C97ULL, 0x12A9F5817FF2D65DULL, 0xA484C3AD38DC9C19ULL, 0xFBE00A8A1EF8AD72ULL,
+    0x750D079407521363ULL, 0x64FEED9C724C2FAFULL, 0xF02B263B328E2B60ULL, 0x9D64555A9A10B852ULL,
+    0xD106FF0BED5255D7ULL, 0xE1652C6B138C64A5ULL, 0xE428581186EC8F46ULL, 0xAEB5F5EDE22D1A36ULL,
+    0xE943D7568AEC0C5CULL, 0xDF98C8276F54B04BULL, 0xB160E4680F6C696FULL, 0xFA0752B07D9C4AB8ULL,
+    0xCA3A2B036DBC8502ULL, 0x5E0905517BB59BCFULL, 0x814EEB3B91D90726ULL, 0x4D49DB1532919C9FULL,
+    0x25EB5FC3F8CF0621ULL, 0xAB6A20C0620D1C6FULL, 0x79E90DBC98F92CCAULL, 0x866ECEDD8072BB0EULL,
+    0x8B54536F2F3E64A8ULL, 0xEA51D3975595B86BULL, 0xCAFFC6AC4542DE31ULL, 0x8DD45A2DDF90796CULL,
+    0x1029D55E880EC2D0ULL, 0x5D86CB23639DBEA9ULL, 0x1D1CA853AE7C0C5FULL, 0xCE332329248F3228ULL,
+    0x8405D1ABE24FB942ULL, 0xE643D78090CA4207ULL, 0x48221B9937748A23ULL, 0xDD7C0BBD61FAFD54ULL,
+    0x2FBC291A570DB5C4ULL, 0xE07C30D7E4E26E12ULL, 0x0953E2258E8E90A1ULL, 0x5B711BC4CEEBF2EEULL,
+    0xCC083F1E6D9E85F6ULL, 0xD2FD8867D50D2DFEULL, 0x06E7EA22CE92708FULL, 0x166B40B44ABA4BD6ULL,
+};
+
+// 单位密钥测试：明文为 0，密钥除校验位外只有一位为 1
+static const struct
+{
+    uint64_t key;
+    uint64_t cipher;
+} VARIABLE_KEY[56] = {
+    {0x8001010101010101ULL, 0x95A8D72813DAA94DULL}, {0x4001010101010101ULL, 0x0EEC1487DD8C26D5ULL},
+    {0x2001010101010101ULL, 0x7AD16FFB79C45926ULL}, {0x1001010101010101ULL, 0xD3746294CA6A6CF3ULL},
+    {0x0801010101010101ULL, 0x809F5F873C1FD761ULL}, {0x0401010101010101ULL, 0xC02FAFFEC989D1FCULL},
+    {0x0201010101010101ULL, 0x4615AA1D33E72F10ULL}, {0x0180010101010101ULL, 0x2055123350C00858ULL},
+    {0x0140010101010101ULL, 0xDF3B99D6577397C8ULL}, {0x0120010101010101ULL, 0x31FE17369B5288C9ULL},
+    {0x0110010101010101ULL, 0xDFDD3CC64DAE1642ULL}, {0x0108010101010101ULL, 0x178C83CE2B399D94ULL},
+    {0x0104010101010101ULL, 0x50F636324A9B7F80ULL}, {0x0102010101010101ULL, 0xA8468EE3BC18F06DULL},
+    {0x0101800101010101ULL, 0xA2DC9E92FD3CDE92ULL}, {0x0101400101010101ULL, 0xCAC09F797D031287ULL},
+    {0x0101200101010101ULL, 0x90BA680B22AEB525ULL}, {0x0101100101010101ULL, 0xCE7A24F350E280B6ULL},
+    {0x0101080101010101ULL, 0x882BFF0AA01A0B87ULL}, {0x0101040101010101ULL, 0x25610288924511C2ULL},
+    {0x0101020101010101ULL, 0xC71516C29C75D170ULL}, {0x0101018001010101ULL, 0x5199C29A52C9F059ULL},
+    {0x0101014001010101ULL, 0xC22F0A294A71F29FULL}, {0x0101012001010101ULL, 0xEE371483714C02EAULL},
+    {0x0101011001010101ULL, 0xA81FBD448F9E522FULL}, {0x0101010801010101ULL, 0x4F644C92E192DFEDULL},
+    {0x0101010401010101ULL, 0x1AFA9A66A6DF92AEULL}, {0x0101010201010101ULL, 0xB3C1CC715CB879D8ULL},
+    {0x0101010180010101ULL, 0x19D032E64AB0BD8BULL}, {0x0101010140010101ULL, 0x3CFAA7A7DC8720DCULL},
+    {0x0101010120010101ULL, 0xB7265F7F447AC6F3ULL}, {0x0101010110010101ULL, 0x9DB73B3C0D163F54ULL},
+    {0x0101010108010101ULL, 0x8181B65BABF4A975ULL}, {0x0101010104010101ULL, 0x93C9B64042EAA240ULL},
+    {0x0101010102010101ULL, 0x5570530829705592ULL}, {0x0101010101800101ULL, 0x8638809E878787A0ULL},
+    {0x0101010101400101ULL, 0x41B9A79AF79AC208ULL}, {0x0101010101200101ULL, 0x7A9BE42F2009A892ULL},
+    {0x0101010101100101ULL, 0x29038D56BA6D2745ULL}, {0x0101010101080101ULL, 0x5495C6ABF1E5DF51ULL},
+    {0x0101010101040101ULL, 0xAE13DBD561488933ULL}, {0x0101010101020101ULL, 0x024D1FFA8904E389ULL},
+    {0x0101010101018001ULL, 0xD1399712F99BF02EULL}, {0x0101010101014001ULL, 0x14C1D7C1CFFEC79EULL},
+    {0x0101010101012001ULL, 0x1DE5279DAE3BED6FULL}, {0x0101010101011001ULL, 0xE941A33F85501303ULL},
+    {0x0101010101010801ULL, 0xDA99DBBC9A03F379ULL}, {0x0101010101010401ULL, 0xB7FC92F91D8E92E9ULL},
+    {0x0101010101010201ULL, 0xAE8E5CAA3CA04E85ULL}, {0x0101010101010180ULL, 0x9CC62DF43B6EED74ULL},
+    {0x0101010101010140ULL, 0xD863DBB5C59A91A0ULL}, {0x0101010101010120ULL, 0xA1AB2190545B91D7ULL},
+    {0x0101010101010110ULL, 0x0875041E64C570F7ULL}, {0x0101010101010108ULL, 0x5A594528BEBEF1CCULL},
+    {0x0101010101010104ULL, 0xFCDB3291DE21F0C0ULL}, {0x0101010101010102ULL, 0x869EFD7F9F265A09ULL},
+};
+
+// FIPS 81 附录中的例子：密钥 0123456789ABCDEF，IV 1234567890ABCDEF，明文 "Now is the time for all "
+static const char FIPS81_PLAIN[] = "Now is the time for all ";
+static const struct
+{
+    int chaining;
+    uint64_t cipher[3];
+} FIPS81[] = {
+    {DES_ECB, {0x3FA40E8A984D4815ULL, 0x6A271787AB8883F9ULL, 0x893D51EC4B563B53ULL}},
+    {DES_CBC, {0xE5C7CDDE872BF27CULL, 0x43E934008C389C0FULL, 0x683788499A7C05F6ULL}},
+    {DES_CFB, {0xF3096249C7F46E51ULL, 0xA69E839B1A92F784ULL, 0x03467133898EA622ULL}},
+    {DES_OFB, {0xF3096249C7F46E51ULL, 0x35F24A242EEB3D3FULL, 0x3D6D5BE3255AF8C3ULL}},
+};
+
+// 差分测试的块数，覆盖各实现的批量大小及其前后的边界
+static const size_t BLOCK_COUNTS[] = {1, 2, 63, 64, 65, 127, 128, 129, 255, 256, 257, 511, 512, 513, 1024 + 77};
+#define MAX_BLOCKS (1024 + 77)
+
+// 流测试的消息长度，覆盖填充的各种情况
+static const size_t MESSAGE_LENGTHS[] = {0, 1, 7, 8, 9, 15, 16, 17, 511, 512, 513, 4095, 4096, 4097, MAX_BLOCKS * 8 + 3};
+#define NMESSAGES (sizeof(MESSAGE_LENGTHS) / sizeof(MESSAGE_LENGTHS[0]))
+#define MAX_MESSAGE (MAX_BLOCKS * 8 + 3)
+
+static const char *MODE_NAMES[] = {"ecb", "cbc", "cfb", "ofb", "ctr"};
+#define NMODES 5
+
+static int failures;
+
+static void fail(const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    fprintf(stderr, "selftest [%s%s]: ", des_backend_name(), des_constant_time() ? ", constant-time" : "");
+    vfprintf(stderr, format, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    failures++;
+}
+
+/**
+ * @brief 批量加密 nblocks 个块后与期望值比较，再解密回原文
+ */
+static void check_blocks(const des_key_schedule_t *schedule, const uint64_t plain[], const uint64_t cipher[], size_t nblocks, const char *name)
+{
+    char *in = (char *)calloc(nblocks, 8), *out = (char *)malloc(nblocks * 8);
+    for (size_t i = 0; i < nblocks; ++i)
+        split_uint64(plain[i], in + i * 8);
+
+    des_ecb_blocks(schedule, DES_ENCRYPT, in, out, nblocks);
+    for (size_t i = 0; i < nblocks; ++i)
+        if (join_uint64(out + i * 8) != cipher[i])
+        {
+            fail("%s: block %zu of %zu encrypts to %016llx, expected %016llx", name, i, nblocks,
+                 (unsigned long long)join_uint64(out + i * 8), (unsigned long long)cipher[i]);
+            break;
+        }
+
+    des_ecb_blocks(schedule, DES_DECRYPT, out, out, nblocks);
+    if (memcmp(in, out, nblocks * 8) != 0)
+        fail("%s: decryption of %zu blocks does not restore the plaintext", name, nblocks);
+
+    // K1 = K2 = K3 时 3DES EDE 退化为 DES
+    des3_key_schedule_t schedule3 = {{*schedule, *schedule, *schedule}};
+    des3_ecb_blocks(&schedule3, DES_ENCRYPT, in, out, nblocks);
+    for (size_t i = 0; i < nblocks; ++i)
+        if (join_uint64(out + i * 8) != cipher[i])
+        {
+            fail("%s: 3DES with equal keys differs from DES at block %zu of %zu", name, i, nblocks);
+            break;
+        }
+
+    free(in);
+    free(out);
+}
+
+static void known_answer_tests()
+{
+    // 重复到超过最宽的批量，使每个实现的批量路径和逐块路径都被覆盖
+    static uint64_t plain[BITSLICE_MAX_BLOCKS + 3], cipher[BITSLICE_MAX_BLOCKS + 3];
+    size_t n = BITSLICE_MAX_BLOCKS + 3;
+    des_key_schedule_t schedule;
+
+    des_key_schedule(0x0101010101010101ULL, &schedule);
+    for (size_t i = 0; i < n; ++i)
+    {
+        plain[i] = 1ULL << (63 - i % 64);
+        cipher[i] = VARIABLE_PLAINTEXT[i % 64];
+    }
+    check_blocks(&schedule, plain, cipher, n, "variable plaintext");
+
+    for (int k = 0; k < 56; ++k)
+    {
+        des_key_schedule(VARIABLE_KEY[k].key, &schedule);
+        for (size_t i = 0; i < n; ++i)
+        {
+            plain[i] = 0;
+            cipher[i] = VARIABLE_KEY[k].cipher;
+        }
+        check_blocks(&schedule, plain, cipher, n, "variable key");
+    }
+
+    des_key_schedule(0x133457799BBCDFF1ULL, &schedule);
+    plain[0] = 0x0123456789ABCDEFULL;
+    cipher[0] = 0x85E813540F0AB405ULL;
+    check_blocks(&schedule, plain, cipher, 1, "133457799BBCDFF1");
+
+    char iv[8], out[32];
+    des_key_schedule(0x0123456789ABCDEFULL, &schedule);
+    split_uint64(0x1234567890ABCDEFULL, iv);
+    for (int m = 0; m < (int)(sizeof(FIPS81) / sizeof(FIPS81[0])); ++m)
+    {
+        struct des_stream *stream = des_open_schedule(DES_ENCRYPT, &schedule);
+        des_set_iv(stream, FIPS81[m].chaining, iv);
+        long len = des_crypt_final(stream, FIPS81_PLAIN, 24, out, sizeof(out));
+        for (int i = 0; i < 3; ++i)
+            if (len < 24 || join_uint64(out + i * 8) != FIPS81[m].cipher[i])
+            {
+                fail("FIPS 81 %s example: block %d differs", MODE_NAMES[FIPS81[m].chaining], i);
+                break;
+            }
+
+        stream = des_open_schedule(DES_DECRYPT, &schedule);
+        des_set_iv(stream, FIPS81[m].chaining, iv);
+        if (len < 0 || des_crypt_final(stream, out, len, out, sizeof(out)) != 24 || memcmp(out, FIPS81_PLAIN, 24) != 0)
+            fail("FIPS 81 %s example: decryption does not restore the plaintext", MODE_NAMES[FIPS81[m].chaining]);
+    }
+}
+
+/**
+ * @brief 位切片实现的密钥搜索内核：一批单位密钥中只有与期望密文对应的密钥匹配
+ */
+static void search_tests()
+{
+    const char *name = des_backend_name();
+    const bitslice_backend_t *p = strcmp(name, "scalar") == 0 ? NULL : bitslice_backend(name);
+    if (!p)
+        return;
+
+    uint64_t keys[BITSLICE_MAX_BLOCKS], match[BITSLICE_MAX_BLOCKS / 64];
+    for (int j = 0; j < p->blocks; ++j)
+        keys[j] = VARIABLE_KEY[j % 56].key;
+    for (int k = 0; k < 56; ++k)
+    {
+        p->search(keys, 0, VARIABLE_KEY[k].cipher, match);
+        for (int j = 0; j < p->blocks; ++j)
+            if ((int)((match[j / 64] >> (j % 64)) & 1) != (j % 56 == k))
+            {
+                fail("key search: key %d of the batch %s", j, j % 56 == k ? "not found" : "wrongly matched");
+                break;
+            }
+    }
+}
+
+/**
+ * @brief 随机生成的测试数据，期望值由逐块调用 des_chunk 的 scalar 实现计算
+ */
+static struct
+{
+    des_key_schedule_t schedule;
+    des3_key_schedule_t schedule3;
+    char iv[8];
+    uint64_t plain[MAX_BLOCKS];
+    uint64_t cipher[MAX_BLOCKS];
+    uint64_t cipher3[MAX_BLOCKS];
+    char message[MAX_MESSAGE];
+    // 每种分组模式下每种长度的消息一次性加密的结果
+    char *encrypted[NMODES][NMESSAGES];
+    long encrypted_len[NMODES][NMESSAGES];
+} data;
+
+static void random_bytes(char buf[], size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        buf[i] = rand();
+}
+
+static void generate_data()
+{
+    // 密钥同样由 rand 生成，使测试可以由种子重现
+    uint64_t keys[3];
+    char block[8];
+    for (int i = 0; i < 3; ++i)
+    {
+        random_bytes(block, 8);
+        keys[i] = des_set_parity(join_uint64(block));
+    }
+    des_key_schedule(keys[0], &data.schedule);
+    des3_key_schedule(keys, &data.schedule3);
+    random_bytes(data.iv, sizeof(data.iv));
+    random_bytes(data.message, sizeof(data.message));
+
+    for (int i = 0; i < MAX_BLOCKS; ++i)
+    {
+        random_bytes(block, 8);
+        data.plain[i] = join_uint64(block);
+        des_ecb_blocks(&data.schedule, DES_ENCRYPT, block, block, 1);
+        data.cipher[i] = join_uint64(block);
+        split_uint64(data.plain[i], block);
+        des3_ecb_blocks(&data.schedule3, DES_ENCRYPT, block, block, 1);
+        data.cipher3[i] = join_uint64(block);
+    }
+
+    for (int m = 0; m < NMODES; ++m)
+        for (size_t l = 0; l < NMESSAGES; ++l)
+        {
+            data.encrypted[m][l] = (char *)malloc(MESSAGE_LENGTHS[l] + 8);
+            struct des_stream *stream = des_open_schedule(DES_ENCRYPT, &data.schedule);
+            des_set_iv(stream, m, data.iv);
+            data.encrypted_len[m][l] = des_crypt_final(stream, data.message, MESSAGE_LENGTHS[l], data.encrypted[m][l], MESSAGE_LENGTHS[l] + 8);
+        }
+}
+
+static void free_data()
+{
+    for (int m = 0; m < NMODES; ++m)
+        for (size_t l = 0; l < NMESSAGES; ++l)
+            free(data.encrypted[m][l]);
+}
+
+static void differential_tests()
+{
+    for (size_t c = 0; c < sizeof(BLOCK_COUNTS) / sizeof(BLOCK_COUNTS[0]); ++c)
+    {
+        check_blocks(&data.schedule, data.plain, data.cipher, BLOCK_COUNTS[c], "random DES");
+
+        size_t n = BLOCK_COUNTS[c];
+        char *buf = (char *)malloc(n * 8);
+        for (size_t i = 0; i < n; ++i)
+            split_uint64(data.plain[i], buf + i * 8);
+        des3_ecb_blocks(&data.schedule3, DES_ENCRYPT, buf, buf, n);
+        for (size_t i = 0; i < n; ++i)
+            if (join_uint64(buf + i * 8) != data.cipher3[i])
+            {
+                fail("random 3DES: block %zu of %zu differs", i, n);
+                break;
+            }
+        des3_ecb_blocks(&data.schedule3, DES_DECRYPT, buf, buf, n);
+        for (size_t i = 0; i < n; ++i)
+            if (join_uint64(buf + i * 8) != data.plain[i])
+            {
+                fail("random 3DES: decryption of %zu blocks does not restore the plaintext", n);
+                break;
+            }
+        free(buf);
+    }
+}
+
+/**
+ * @brief 把输入切成随机长度的分段依次送入 des_update，模拟 fread 读到的任意边界
+ * @return 输出的总长度，失败时返回 -1
+ */
+static long update_in_pieces(struct des_stream *stream, const char in[], size_t len, char out[], size_t outlen)
+{
+    size_t done = 0, olen = 0;
+    while (done < len)
+    {
+        size_t piece = rand() % 4 == 0 ? rand() % 4096 : rand() % 24;
+        if (piece > len - done)
+            piece = len - done;
+        int n = des_update(stream, (char *)in + done, piece, out + olen, outlen - olen);
+        if (n < 0)
+        {
+            free(stream);
+            return -1;
+        }
+        done += piece;
+        olen += n;
+    }
+    int n = des_final(stream, out + olen, outlen - olen);
+    return n < 0 ? -1 : (long)(olen + n);
+}
+
+static void stream_tests()
+{
+    char *out = (char *)malloc(MAX_MESSAGE + 16);
+    for (int m = 0; m < NMODES; ++m)
+        for (size_t l = 0; l < NMESSAGES; ++l)
+        {
+            size_t len = MESSAGE_LENGTHS[l];
+            const char *expected = data.encrypted[m][l];
+            long expected_len = data.encrypted_len[m][l];
+
+            struct des_stream *stream = des_open_schedule(DES_ENCRYPT, &data.schedule);
+            des_set_iv(stream, m, data.iv);
+            long n = update_in_pieces(stream, data.message, len, out, MAX_MESSAGE + 16);
+            if (n != expected_len || memcmp(out, expected, n) != 0)
+                fail("%s: encrypting %zu bytes in pieces differs", MODE_NAMES[m], len);
+
+            stream = des_open_schedule(DES_DECRYPT, &data.schedule);
+            des_set_iv(stream, m, data.iv);
+            n = update_in_pieces(stream, expected, expected_len, out, MAX_MESSAGE + 16);
+            if (n != (long)len || memcmp(out, data.message, len) != 0)
+                fail("%s: decrypting %zu bytes in pieces does not restore the plaintext", MODE_NAMES[m], len);
+
+            // 原地解密
+            memcpy(out, expected, expected_len);
+            stream = des_open_schedule(DES_DECRYPT, &data.schedule);
+            des_set_iv(stream, m, data.iv);
+            n = des_crypt_final(stream, out, expected_len, out, expected_len);
+            if (n != (long)len || memcmp(out, data.message, len) != 0)
+                fail("%s: decrypting %zu bytes in place does not restore the plaintext", MODE_NAMES[m], len);
+        }
+    free(out);
+}
+
+int des_selftest(unsigned int seed)
+{
+    const char *saved = des_backend_name();
+    failures = 0;
+    srand(seed);
+
+    // 期望值全部由逐块处理的 scalar 实现计算
+    des_use_backend("scalar");
+    generate_data();
+
+    const char *backends[8];
+    int nbackends = 0;
+    backends[nbackends++] = "scalar";
+    for (const bitslice_backend_t *p = BITSLICE_BACKENDS; p->name; ++p)
+        if (bitslice_backend(p->name))
+            backends[nbackends++] = p->name;
+
+    for (int b = 0; b < nbackends; ++b)
+    {
+        if (!des_use_backend(backends[b]))
+            continue;
+        known_answer_tests();
+        search_tests();
+        differential_tests();
+        stream_tests();
+    }
+
+    // 常数时间模式下选择 scalar 时所有的块都补齐后交给最窄的位切片实现，选择其他实现时只有尾部补齐
+    bool saved_constant_time = des_constant_time();
+    for (int b = 0; b < nbackends && des_set_constant_time(true); ++b)
+    {
+        if (!des_use_backend(backends[b]))
+            continue;
+        known_answer_tests();
+        differential_tests();
+        stream_tests();
+    }
+    des_set_constant_time(saved_constant_time);
+
+    free_data();
+    des_use_backend(saved);
+    return failures;
+}
@@ -0,0 +1,195 @@
+/**
+ * @brief 生成 DES 使用的常量表
+ * @note 由 Makefile 在编译前运行，将置换查找表、SP 盒和位切片内核的下标映射表展开为 static const 数据输出到
+ * des_tables.h，程序运行时不再需要计算任何表，编译器也可以把位切片内核中的下标折叠为常量。
+ * 查找表在输出前与逐位置换的参考实现逐项比对，不一致时生成失败。
+ */
+#include "permutation.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief 置换后第 q 位（最低位为第 0 位）来自置换前的第几位
+ */
+static int map_bit(const permutation_t *perm, int q)
+{
+    return perm->from_bits - 1 - perm->table[perm->to_bits - 1 - q];
+}
+
+/**
+ * @brief 以嵌套的大括号输出多维数组
+ * @param values 按行优先排列的数组
+ * @param dims 各维的长度
+ * @param ndims 维数
+ * @param width 每个元素输出的十六进制位数，为 0 时以十进制输出
+ */
+static void print_array(const uint64_t *values, const int dims[], int ndims, int width, int indent)
+{
+    int stride = 1;
+    for (int d = 1; d < ndims; ++d)
+        stride *= dims[d];
+
+    printf("{");
+    if (ndims == 1)
+    {
+        for (int i = 0; i < dims[0]; ++i)
+        {
+            if (i > 0)
+                printf(i % 8 == 0 ? ",\n%*s" : ", ", i % 8 == 0 ? indent + 1 : 0, "");
+            if (width > 0)
+                printf("0x%0*llX", width, (unsigned long long)values[i]);
+            else
+                printf("%llu", (unsigned long long)values[i]);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < dims[0]; ++i)
+        {
+            if (i > 0)
+                printf(",\n%*s", indent + 1, "");
+            print_array(values + i * stride, dims + 1, ndims - 1, width, indent + 1);
+        }
+    }
+    printf("}");
+}
+
+static void print_ints(const char *name, const int *values, const int dims[], int ndims)
+{
+    int n = 1;
+    for (int d = 0; d < ndims; ++d)
+        n *= dims[d];
+    uint64_t *wide = (uint64_t *)malloc(sizeof(uint64_t) * n);
+    for (int i = 0; i < n; ++i)
+        wide[i] = values[i];
+
+    printf("static const int %s", name);
+    for (int d = 0; d < ndims; ++d)
+        printf("[%d]", dims[d]);
+    printf(" = ");
+    print_array(wide, dims, ndims, 0, 0);
+    printf(";\n\n");
+    free(wide);
+}
+
+static void print_lut(const char *name, const permutation_t *perm)
+{
+    static permutation_lut_t lut;
+    compile_permutation(perm, &lut);
+    if (!check_permutation_lut(perm, &lut))
+    {
+        fprintf(stderr, "Lookup table %s does not match the permutation\n", name);
+        exit(1);
+    }
+
+    static const int dims[] = {8, 256};
+    printf("static const permutation_lut_t %s = {%d, ", name, lut.from_bytes);
+    print_array(&lut.table[0][0], dims, 2, 16, 0);
+    printf("};\n\n");
+}
+
+static void print_sp_box()
+{
+    static uint64_t sp[8][64];
+    for (int i = 0; i < 8; ++i)
+        for (int x = 0; x < 64; ++x)
+            sp[i][x] = do_permutation(&PERM_P, do_sbox(*S_BOX[i], x) << (28 - 4 * i));
+
+    static const int dims[] = {8, 64};
+    printf("/**\n"
+           " * S 盒与 P 置换合并后的 SP 盒\n"
+           " * SP_BOX[i][x] 为第 i+1 个 S 盒对 6 位输入 x 的 4 位输出放到对应位置后再做 P 置换的 32 位结果，\n"
+           " * 由于 P 置换是按位置换，8 个 SP 盒的查表结果按位或即为轮函数的输出。\n"
+           " */\n"
+           "static const uint32_t SP_BOX[8][64] = ");
+    print_array(&sp[0][0], dims, 2, 8, 0);
+    printf(";\n\n");
+}
+
+static void print_bitslice_maps()
+{
+    int ip[64], ipinv[64];
+    for (int q = 0; q < 64; ++q)
+    {
+        ip[q] = map_bit(&PERM_IP, q);
+        ipinv[q] = map_bit(&PERM_IPINV, q);
+    }
+
+    // 子密钥第 q 位来自循环移位后 CD 的第 map_bit(PC2, q) 位，C、D 各 28 位，循环左移 t 位后
+    // 第 j 位来自移位前的第 j - t 位，再经 PC1 对应到密钥的某一位
+    static const int SHIFT_BITS[] = {1, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1};
+    int round_key[16][8][6];
+    for (int i = 0, t = 0; i < 16; ++i)
+    {
+        t += SHIFT_BITS[i];
+        for (int s = 0; s < 8; ++s)
+            for (int b = 0; b < 6; ++b)
+            {
+                int j = map_bit(&PERM_PC2, 42 - 6 * s + b);
+                int half = j / 28 * 28;
+                round_key[i][s][b] = map_bit(&PERM_PC1, half + (j - half - t % 28 + 28) % 28);
+            }
+    }
+
+    int p_dest[32];
+    for (int q = 0; q < 32; ++q)
+        p_dest[map_bit(&PERM_P, q)] = q;
+
+    int e[8][6], key[8][6], p[8][4], leaves[8][4][16];
+    for (int s = 0; s < 8; ++s)
+    {
+        for (int b = 0; b < 6; ++b)
+        {
+            // S 盒输入的第 b 位是 E 扩展结果（48 位）的第 42 - 6s + b 位
+            e[s][b] = map_bit(&PERM_E_EXTENSION, 42 - 6 * s + b);
+            key[s][b] = 42 - 6 * s + b;
+        }
+        for (int o = 0; o < 4; ++o)
+        {
+            p[s][o] = p_dest[28 - 4 * s + o];
+            for (int k = 0; k < 16; ++k)
+            {
+                int leaf = 0;
+                for (int v = 0; v < 4; ++v)
+                    leaf |= ((do_sbox(*S_BOX[s], (k << 2) | v) >> o) & 1) << v;
+                leaves[s][o][k] = leaf;
+            }
+        }
+    }
+
+    printf("// 置换后第 q 位（最低位为第 0 位）来自置换前的第 IP_MAP[q] 位\n");
+    print_ints("IP_MAP", ip, (const int[]){64}, 1);
+    print_ints("IPINV_MAP", ipinv, (const int[]){64}, 1);
+    printf("// 第 s 个 S 盒的第 b 位输入来自 R 的第 E_MAP[s][b] 位，并与子密钥的第 KEY_MAP[s][b] 位异或\n");
+    print_ints("E_MAP", &e[0][0], (const int[]){8, 6}, 2);
+    print_ints("KEY_MAP", &key[0][0], (const int[]){8, 6}, 2);
+    printf("// 密钥搜索时第 i 轮第 s 个 S 盒的第 b 位子密钥来自 64 位密钥的第 ROUND_KEY_MAP[i][s][b] 位\n");
+    print_ints("ROUND_KEY_MAP", &round_key[0][0][0], (const int[]){16, 8, 6}, 3);
+    printf("// 第 s 个 S 盒的第 o 位输出经过 P 置换后位于 f 的第 P_MAP[s][o] 位\n");
+    print_ints("P_MAP", &p[0][0], (const int[]){8, 4}, 2);
+    printf("// S 盒的真值表：第 s 个 S 盒的第 o 位输出在输入高 4 位为 k 时关于低 2 位的 4 位真值表\n");
+    print_ints("SBOX_LEAF", &leaves[0][0][0], (const int[]){8, 4, 16}, 3);
+}
+
+int main()
+{
+    printf("// 由 tools/gentables.c 生成，不要手动修改\n\n");
+    printf("#ifndef DES_TABLES_H\n#define DES_TABLES_H\n\n");
+    printf("#include \"permutation.h\"\n\n");
+    printf("// clang-format off\n\n");
+
+    print_sp_box();
+
+    printf("// 置换表展开后的按字节查找表，见 permutation_lut_t\n");
+    print_lut("PERM_IP_LUT", &PERM_IP);
+    print_lut("PERM_IPINV_LUT", &PERM_IPINV);
+    print_lut("PERM_SWITCH_LUT", &PERM_SWITCH);
+    print_lut("PERM_PC1_LUT", &PERM_PC1);
+    print_lut("PERM_PC2_LUT", &PERM_PC2);
+
+    print_bitslice_maps();
+
+    printf("// clang-format on\n\n");
+    printf("#endif // DES_TABLES_H\n");
+    return 0;
+}
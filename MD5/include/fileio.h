@@ -0,0 +1,66 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 读取文件的方式
+ */
+enum io_method
+{
+    // 根据文件大小选择，见 choose_io
+    IO_AUTO,
+    // 整个文件读入缓冲区
+    IO_READ,
+    // 整个文件映射到内存中
+    IO_MMAP,
+    // 以对齐的大缓冲区分块读取，文件系统支持时使用 O_DIRECT
+    IO_DIRECT
+};
+
+/**
+ * IO_AUTO 时不超过该大小的普通文件一次读入缓冲区，比映射少一次 munmap 和缺页
+ */
+#define SMALL_FILE_SIZE (64 << 10)
+
+/**
+ * IO_AUTO 时不小于该大小的普通文件分块读取，不占用大量地址空间和页缓存
+ */
+#define LARGE_FILE_SIZE (256 << 20)
+
+/**
+ * @brief 确定读取 fd 的方式
+ * @note IO_AUTO 时普通文件按大小选择 IO_READ、IO_MMAP 或 IO_DIRECT，管道等其余输入长度未知，分块读取
+ */
+enum io_method choose_io(enum io_method method, int fd);
+
+/**
+ * @brief 把整个文件读入内存，用于多路 MD5
+ * @param method IO_MMAP 时映射并设置 MADV_SEQUENTIAL，无法映射时与 IO_READ 一样读入缓冲区
+ * @param len 文件的长度
+ * @param mapped 是否为映射，释放时传给 unload_file
+ * @return 出错时返回 NULL
+ */
+const uint8_t *load_file(int fd, enum io_method method, size_t *len, bool *mapped);
+
+/**
+ * @brief 释放 load_file 读入的文件
+ */
+void unload_file(const uint8_t *data, size_t len, bool mapped);
+
+/**
+ * @brief 分块读取 fd 直到文件末尾并计算 MD5
+ * @note 缓冲区按页对齐，每次读取 DIRECT_BUFFER_SIZE 字节，完整的块由 md5_stream_data 直接从缓冲区压缩。
+ * 文件系统支持时为 fd 加上 O_DIRECT 绕过页缓存，不支持时（如 tmpfs、管道）使用普通的读取。
+ * @return 读取失败时返回 false
+ */
+bool md5_read_direct(int fd, uint8_t digest[16]);
+
+/**
+ * md5_read_direct 每次读取的字节数
+ */
+#define DIRECT_BUFFER_SIZE (8 << 20)
+
+#endif // FILEIO_H
@@ -1,5 +1,6 @@
 #ifndef MD5_H
 #define MD5_H
+#include <stddef.h>
 #include <stdint.h>
 
 struct md5_stream
@@ -13,9 +14,20 @@ struct md5_stream
     uint32_t vector[4];
 };
 
+/**
+ * @brief 对连续的 nblocks 个 512 位块依次执行压缩函数
+ * @param state 128 位的链接变量，初始为 IV，结果原地更新
+ * @param data 长度为 nblocks * 64 字节的数据，不要求对齐
+ */
+void md5_blocks(uint32_t state[4], const uint8_t data[], size_t nblocks);
+
 void md5_stream_begin(struct md5_stream *stream);
 
-void md5_stream_data(struct md5_stream *stream, uint8_t data[], int len);
+/**
+ * @brief 向流中追加数据
+ * @note 只有开头补满缓存块的部分和末尾不足一块的部分被复制到 stream->data，中间完整的块直接从 data 压缩
+ */
+void md5_stream_data(struct md5_stream *stream, const uint8_t data[], size_t len);
 
 void md5_stream_end(struct md5_stream *stream, uint8_t result[16]);
 
@@ -0,0 +1,79 @@
+#ifndef MD5_MB_H
+#define MD5_MB_H
+
+#include "md5.h"
+#include <stdbool.h>
+
+/**
+ * 多路实现同时处理的最大路数
+ */
+#define MD5_MB_MAX_LANES 16
+
+/**
+ * 多路 MD5 的一种实现，SIMD 实现在向量寄存器的每个 32 位元素中计算一路相互独立的消息
+ */
+typedef struct
+{
+    const char *name;
+    // 同时处理的路数
+    int lanes;
+    // 当前 CPU 是否支持该实现
+    bool (*supported)();
+    /**
+     * @brief 对 lanes 路消息各压缩 nblocks 个块
+     * @param state 各路的链接变量，结果原地更新
+     * @param data 各路的数据，每路 nblocks * 64 字节
+     */
+    void (*blocks)(uint32_t *const state[], const uint8_t *const data[], size_t nblocks);
+} md5_mb_backend_t;
+
+/**
+ * 所有的多路实现，按路数从大到小排列，以 name 为 NULL 的项结尾；最后一项 scalar 为单路实现
+ */
+extern const md5_mb_backend_t MD5_MB_BACKENDS[];
+
+/**
+ * @brief 通过 cpuid 选择当前 CPU 支持的多路实现
+ * @param name 实现的名字："avx512"、"avx2"、"sse2"、"scalar"，为 NULL 时选择路数最多的实现
+ * @return 不存在或 CPU 不支持时返回 NULL
+ */
+const md5_mb_backend_t *md5_mb_backend(const char *name);
+
+/**
+ * 多路 MD5 的一个任务，消息为内存中连续的一段数据
+ */
+struct md5_mb_job
+{
+    const uint8_t *data;
+    size_t len;
+    uint8_t digest[16];
+    // 调用者使用的数据
+    void *user;
+};
+
+/**
+ * 多路 MD5 的任务队列
+ */
+struct md5_mb_queue
+{
+    /**
+     * @brief 取下一个任务，任务在 done 之前必须保持有效
+     * @return 没有更多任务时返回 NULL，此后不会再被调用
+     */
+    struct md5_mb_job *(*next)(struct md5_mb_queue *queue);
+    /**
+     * @brief 任务完成后调用，此时 job->digest 为消息的 MD5，调用后 job->data 不再被访问
+     */
+    void (*done)(struct md5_mb_queue *queue, struct md5_mb_job *job);
+};
+
+/**
+ * @brief 以 backend 的各路同时计算队列中所有消息的 MD5
+ * @note 每一路持有一个 md5_stream，空闲的路立即从队列中取下一个任务；所有忙碌的路都还有剩余的完整块时，
+ * 一起压缩它们中最少的块数，剩余不足一块的路通过 md5_stream 完成填充并空出来。
+ * 队列取空后若只剩一路，剩余部分直接由单路实现完成。
+ * @param backend 多路实现，为 NULL 时选择当前 CPU 支持的路数最多的实现
+ */
+void md5_mb_run(const md5_mb_backend_t *backend, struct md5_mb_queue *queue);
+
+#endif // MD5_MB_H
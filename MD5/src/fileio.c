@@ -0,0 +1,116 @@
+#define _GNU_SOURCE
+#include "fileio.h"
+#include "md5.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum io_method choose_io(enum io_method method, int fd)
+{
+    struct stat st;
+    if (method != IO_AUTO)
+        return method;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return IO_DIRECT;
+    if (st.st_size <= SMALL_FILE_SIZE)
+        return IO_READ;
+    return st.st_size >= LARGE_FILE_SIZE ? IO_DIRECT : IO_MMAP;
+}
+
+/**
+ * @brief 读取 fd 中的全部数据，普通文件按其长度一次分配
+ * @return 出错时返回 NULL
+ */
+static uint8_t *read_all(int fd, size_t *len)
+{
+    struct stat st;
+    size_t capacity = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? st.st_size + 1 : 1 << 16;
+    uint8_t *buf = (uint8_t *)malloc(capacity);
+    *len = 0;
+    ssize_t n;
+    while ((n = read(fd, buf + *len, capacity - *len)) != 0)
+    {
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(buf);
+            return NULL;
+        }
+        *len += n;
+        if (*len == capacity)
+            buf = (uint8_t *)realloc(buf, capacity *= 2);
+    }
+    return buf;
+}
+
+const uint8_t *load_file(int fd, enum io_method method, size_t *len, bool *mapped)
+{
+    struct stat st;
+    *mapped = false;
+    if (method == IO_MMAP && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            *len = st.st_size;
+            *mapped = true;
+            return (const uint8_t *)data;
+        }
+    }
+    return read_all(fd, len);
+}
+
+void unload_file(const uint8_t *data, size_t len, bool mapped)
+{
+    if (mapped)
+        munmap((void *)data, len);
+    else
+        free((void *)data);
+}
+
+bool md5_read_direct(int fd, uint8_t digest[16])
+{
+    uint8_t *buf;
+    if (posix_memalign((void **)&buf, 4096, DIRECT_BUFFER_SIZE) != 0)
+        return false;
+
+    // O_DIRECT 要求缓冲区、长度和偏移都按块对齐，普通文件除最后一次外每次都读满缓冲区，因此都是对齐的
+    struct stat st;
+    int flags = fcntl(fd, F_GETFL);
+    bool direct = flags >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && fcntl(fd, F_SETFL, flags | O_DIRECT) == 0;
+    if (!direct)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    struct md5_stream stream;
+    md5_stream_begin(&stream);
+    bool ok = true;
+    while (true)
+    {
+        ssize_t n = read(fd, buf, DIRECT_BUFFER_SIZE);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EINVAL && direct)
+        {
+            // 文件系统不支持 O_DIRECT 或者读取没有对齐时，改为普通的读取
+            fcntl(fd, F_SETFL, flags);
+            direct = false;
+            continue;
+        }
+        if (n <= 0)
+        {
+            ok = n == 0;
+            break;
+        }
+        md5_stream_data(&stream, buf, n);
+    }
+    if (direct)
+        fcntl(fd, F_SETFL, flags);
+    md5_stream_end(&stream, digest);
+    free(buf);
+    return ok;
+}
@@ -2,8 +2,14 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include "md5.h"
+#include "md5_mb.h"
 #include "binary.h"
+#include "fileio.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
 
 void error(const char *format, ...)
 {
@@ -15,42 +21,437 @@ void error(const char *format, ...)
     exit(2);
 }
 
+// 命令行选项
+struct
+{
+    // 读取校验和文件并验证其中列出的文件
+    bool check;
+    // 验证时不输出 OK 的文件
+    bool quiet;
+    // 验证时什么都不输出，只以退出码表示结果
+    bool status;
+    // 0 表示使用所有 CPU
+    int threads;
+    const md5_mb_backend_t *backend;
+    enum io_method io;
+} options = {false, false, false, 0, NULL, IO_AUTO};
+
 void usage(int argc, char *argv[])
 {
-    fprintf(stderr, "MD5 file hash\n");
-    fprintf(stderr, "Usage: %s [file]\n\n", argv[0]);
+    (void)argc;
+    fprintf(stderr, "MD5 file hash, compatible with md5sum\n");
+    fprintf(stderr, "Usage: %s [options...] [file...]\n", argv[0]);
+    fprintf(stderr, "With no file, or when file is -, read standard input.\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -c, --check: read MD5 sums from the files and check them\n");
+    fprintf(stderr, "  --quiet: don't print OK for each successfully verified file\n");
+    fprintf(stderr, "  --status: don't output anything, status code shows success\n");
+    fprintf(stderr, "  -j, --threads [N]: hash files on N threads, default all CPUs\n");
+    fprintf(stderr, "  --backend [avx512|avx2|sse2|scalar]: multi-buffer implementation, default the widest one the CPU supports\n");
+    fprintf(stderr, "  --io [auto|read|mmap|direct]: read whole files, map them, or read large aligned chunks with O_DIRECT;\n");
+    fprintf(stderr, "      auto reads files up to 64K, maps files up to 256M and reads larger files and pipes in chunks\n");
 }
 
-int main(int argc, char *argv[])
+/**
+ * 一个输入文件，普通文件映射到内存中，其余的读入到缓冲区
+ */
+struct file_job
+{
+    // 必须是第一个成员，完成时由 md5_mb_job 转换回 file_job
+    struct md5_mb_job job;
+    const char *path;
+    // 验证时校验和文件中记录的 MD5
+    uint8_t expected[16];
+    bool mapped;
+    bool failed;
+    bool finished;
+};
+
+/**
+ * 所有工作线程共享的文件列表
+ */
+struct file_list
+{
+    struct file_job *files;
+    int nfiles;
+    // 下一个交给多路 MD5 的文件
+    int next;
+    // 下一个输出结果的文件，结果按参数的顺序输出
+    int printed;
+    // 无法读取和验证失败的文件数
+    int unreadable;
+    int mismatched;
+    pthread_mutex_t lock;
+};
+
+/**
+ * 每个工作线程的任务队列，从共享的文件列表中领取文件
+ */
+struct worker_queue
+{
+    struct md5_mb_queue queue;
+    struct file_list *list;
+};
+
+/**
+ * @brief 与 md5sum 一致，文件名中含有反斜杠或换行时整行以反斜杠开头，文件名中的这两个字符转义输出
+ */
+void print_path(FILE *out, const char *path)
+{
+    for (; *path; ++path)
+    {
+        if (*path == '\\')
+            fputs("\\\\", out);
+        else if (*path == '\n')
+            fputs("\\n", out);
+        else
+            fputc(*path, out);
+    }
+}
+
+bool needs_escape(const char *path)
+{
+    return strpbrk(path, "\\\n") != NULL;
+}
+
+/**
+ * @brief 打开文件，按 options.io 选择的方式读取
+ * @return 1 表示已经读入内存，交给多路 MD5；0 表示已经分块读取并算出 MD5；-1 表示无法读取
+ */
+int open_file(struct file_job *file)
+{
+    int fd = strcmp(file->path, "-") == 0 ? STDIN_FILENO : open(file->path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    int ret;
+    enum io_method method = choose_io(options.io, fd);
+    if (method == IO_DIRECT)
+        ret = md5_read_direct(fd, file->job.digest) ? 0 : -1;
+    else
+    {
+        file->job.data = load_file(fd, method, &file->job.len, &file->mapped);
+        ret = file->job.data ? 1 : -1;
+    }
+    if (fd != STDIN_FILENO)
+        close(fd);
+    return ret;
+}
+
+void print_result(struct file_job *file)
+{
+    if (options.check)
+    {
+        bool ok = !file->failed && memcmp(file->job.digest, file->expected, 16) == 0;
+        if (file->failed)
+            fprintf(stderr, "md5: %s: No such file or unable to read\n", file->path);
+        if (options.status || (ok && options.quiet))
+            return;
+        if (needs_escape(file->path))
+            putchar('\\');
+        print_path(stdout, file->path);
+        printf(": %s\n", ok ? "OK" : file->failed ? "FAILED open or read" : "FAILED");
+        return;
+    }
+
+    if (file->failed)
+    {
+        fprintf(stderr, "md5: %s: No such file or unable to read\n", file->path);
+        return;
+    }
+    if (needs_escape(file->path))
+        putchar('\\');
+    for (int i = 0; i < 16; ++i)
+        printf("%02x", file->job.digest[i]);
+    printf("  ");
+    print_path(stdout, file->path);
+    putchar('\n');
+}
+
+/**
+ * @brief 按顺序输出已经完成的文件，调用时需持有 list->lock
+ */
+void print_finished(struct file_list *list)
+{
+    for (; list->printed < list->nfiles && list->files[list->printed].finished; list->printed++)
+    {
+        struct file_job *file = &list->files[list->printed];
+        if (file->failed)
+            list->unreadable++;
+        else if (options.check && memcmp(file->job.digest, file->expected, 16) != 0)
+            list->mismatched++;
+        print_result(file);
+    }
+}
+
+struct md5_mb_job *next_file(struct md5_mb_queue *queue)
+{
+    struct file_list *list = ((struct worker_queue *)queue)->list;
+    while (true)
+    {
+        pthread_mutex_lock(&list->lock);
+        struct file_job *file = list->next < list->nfiles ? &list->files[list->next++] : NULL;
+        pthread_mutex_unlock(&list->lock);
+        if (!file)
+            return NULL;
+        int ret = open_file(file);
+        if (ret > 0)
+            return &file->job;
+
+        // 分块读取的大文件已经算出结果，不经过多路 MD5
+        pthread_mutex_lock(&list->lock);
+        file->failed = ret < 0;
+        file->finished = true;
+        print_finished(list);
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+
+void file_done(struct md5_mb_queue *queue, struct md5_mb_job *job)
 {
-    if (argc < 2)
+    struct file_list *list = ((struct worker_queue *)queue)->list;
+    struct file_job *file = (struct file_job *)job;
+    unload_file(job->data, job->len, file->mapped);
+
+    pthread_mutex_lock(&list->lock);
+    file->finished = true;
+    print_finished(list);
+    pthread_mutex_unlock(&list->lock);
+}
+
+void *worker(void *arg)
+{
+    struct worker_queue queue = {{next_file, file_done}, (struct file_list *)arg};
+    md5_mb_run(options.backend, &queue.queue);
+    return NULL;
+}
+
+/**
+ * @brief 在 options.threads 个线程中计算所有文件的 MD5，每个线程各自运行一个多路 MD5
+ */
+void hash_files(struct file_list *list)
+{
+    list->next = list->printed = list->unreadable = list->mismatched = 0;
+    pthread_mutex_init(&list->lock, NULL);
+
+    int threads = options.threads > 0 ? options.threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > list->nfiles)
+        threads = list->nfiles;
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+
+    // 线程创建失败时，由调用线程完成剩余的文件
+    int started = 0;
+    for (; started < threads; ++started)
+        if (pthread_create(&tids[started], NULL, worker, list) != 0)
+            break;
+    if (started < threads)
+        worker(list);
+    for (int i = 0; i < started; ++i)
+        pthread_join(tids[i], NULL);
+
+    pthread_mutex_destroy(&list->lock);
+    free(tids);
+}
+
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool parse_digest(const char *hex, uint8_t digest[16])
+{
+    for (int i = 0; i < 16; ++i)
     {
-        usage(argc, argv);
-        return 1;
+        int hi = hex_value(hex[i * 2]), lo = hi < 0 ? -1 : hex_value(hex[i * 2 + 1]);
+        if (lo < 0)
+            return false;
+        digest[i] = (hi << 4) | lo;
     }
-    
+    return true;
+}
 
-    FILE *infile = fopen(argv[1], "rb");
-    if (!infile)
-        error("Unable to open input file %s", argv[3]);
+/**
+ * @brief 去除文件名中的转义，见 print_path
+ * @return 转义不合法时返回 false
+ */
+bool unescape_path(char *path)
+{
+    char *out = path;
+    for (char *p = path; *p; ++p)
+    {
+        if (*p != '\\')
+            *out++ = *p;
+        else if (p[1] == '\\')
+            *out++ = '\\', ++p;
+        else if (p[1] == 'n')
+            *out++ = '\n', ++p;
+        else
+            return false;
+    }
+    *out = '\0';
+    return true;
+}
 
-    struct md5_stream stream;
-    md5_stream_begin(&stream);
+/**
+ * @brief 解析校验和文件中的一行，支持 md5sum 的 "hash  file"、"hash *file" 和 BSD 的 "MD5 (file) = hash"
+ * @return 格式不正确时返回 false
+ */
+bool parse_check_line(char *line, struct file_job *file)
+{
+    bool escaped = line[0] == '\\';
+    if (escaped)
+        line++;
+
+    char *path;
+    if (strncmp(line, "MD5 (", 5) == 0)
+    {
+        char *sep = strstr(line, ") = ");
+        // 文件名中可能含有 ") = "，以最后一个为准
+        for (char *p = sep; p; p = strstr(p + 1, ") = "))
+            sep = p;
+        if (!sep || strlen(sep + 4) != 32 || !parse_digest(sep + 4, file->expected))
+            return false;
+        *sep = '\0';
+        path = line + 5;
+    }
+    else
+    {
+        if (strlen(line) < 35 || !parse_digest(line, file->expected) || line[32] != ' ' || (line[33] != ' ' && line[33] != '*'))
+            return false;
+        path = line + 34;
+    }
+    if (*path == '\0' || (escaped && !unescape_path(path)))
+        return false;
+    file->path = strdup(path);
+    return true;
+}
 
-    uint8_t rbuf[1024];
-    size_t rlen, wlen;
-    while ((rlen = fread(rbuf, sizeof(uint8_t), 1024, infile)))
+/**
+ * @brief 读取校验和文件，把其中列出的文件追加到 list 中
+ * @return 格式不正确的行数
+ */
+int read_check_file(const char *path, struct file_list *list, int *capacity)
+{
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!in)
+        error("md5: %s: No such file or directory", path);
+    int improper = 0;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &size, in)) >= 0)
     {
-        md5_stream_data(&stream, rbuf, rlen);
+        if (len > 0 && line[len - 1] == '\n')
+            line[--len] = '\0';
+        if (len > 0 && line[len - 1] == '\r')
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+        if (list->nfiles == *capacity)
+            list->files = (struct file_job *)realloc(list->files, sizeof(struct file_job) * (*capacity *= 2));
+        struct file_job *file = &list->files[list->nfiles];
+        memset(file, 0, sizeof(*file));
+        if (parse_check_line(line, file))
+            list->nfiles++;
+        else
+            improper++;
     }
+    free(line);
+    if (in != stdin)
+        fclose(in);
+    return improper;
+}
 
-    uint8_t result[16];
-    md5_stream_end(&stream, result);
-    fclose(infile);
+int main(int argc, char *argv[])
+{
+    const char **paths = (const char **)malloc(sizeof(char *) * (argc + 1));
+    int npaths = 0;
+    bool end_of_options = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (end_of_options || arg[0] != '-' || strcmp(arg, "-") == 0)
+            paths[npaths++] = arg;
+        else if (strcmp(arg, "--") == 0)
+            end_of_options = true;
+        else if (strcmp(arg, "-c") == 0 || strcmp(arg, "--check") == 0)
+            options.check = true;
+        else if (strcmp(arg, "--quiet") == 0)
+            options.quiet = true;
+        else if (strcmp(arg, "--status") == 0)
+            options.status = true;
+        else if ((strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0) && i + 1 < argc)
+        {
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 1)
+                error("Number of threads must be positive");
+        }
+        else if (strcmp(arg, "--backend") == 0 && i + 1 < argc)
+        {
+            options.backend = md5_mb_backend(argv[++i]);
+            if (!options.backend)
+                error("Backend %s is not supported", argv[i]);
+        }
+        else if (strcmp(arg, "--io") == 0 && i + 1 < argc)
+        {
+            static const char *METHODS[] = {"auto", "read", "mmap", "direct"};
+            const char *value = argv[++i];
+            int m = 0;
+            while (m < 4 && strcmp(value, METHODS[m]) != 0)
+                m++;
+            if (m == 4)
+                error("Unknown I/O method %s", value);
+            options.io = m; // 与 IO_AUTO ... IO_DIRECT 的顺序一致
+        }
+        else
+        {
+            usage(argc, argv);
+            return 1;
+        }
+    }
+    if (npaths == 0)
+        paths[npaths++] = "-";
 
-    for (int i = 0; i < 16; ++i) printf("%02x", result[i]);
+    struct file_list list;
+    int capacity = npaths;
+    list.files = (struct file_job *)calloc(capacity, sizeof(struct file_job));
+    list.nfiles = 0;
+    int improper = 0;
+    if (options.check)
+    {
+        for (int i = 0; i < npaths; ++i)
+            improper += read_check_file(paths[i], &list, &capacity);
+        if (list.nfiles == 0)
+            error("md5: no properly formatted MD5 checksum lines found");
+    }
+    else
+    {
+        for (int i = 0; i < npaths; ++i)
+            list.files[list.nfiles++].path = paths[i];
+    }
 
-    printf("  %s\n", argv[1]);
+    hash_files(&list);
+    fflush(stdout);
 
-    return 1;
-}
\ No newline at end of file
+    if (options.check && !options.status)
+    {
+        if (improper > 0)
+            fprintf(stderr, "md5: WARNING: %d line%s improperly formatted\n", improper, improper > 1 ? "s are" : " is");
+        if (list.unreadable > 0)
+            fprintf(stderr, "md5: WARNING: %d listed file%s could not be read\n", list.unreadable, list.unreadable > 1 ? "s" : "");
+        if (list.mismatched > 0)
+            fprintf(stderr, "md5: WARNING: %d computed checksum%s did NOT match\n", list.mismatched, list.mismatched > 1 ? "s" : "");
+    }
+    int failed = list.unreadable + list.mismatched;
+    if (options.check)
+        for (int i = 0; i < list.nfiles; ++i)
+            free((char *)list.files[i].path);
+    free(list.files);
+    free(paths);
+    return failed > 0 ? 1 : 0;
+}
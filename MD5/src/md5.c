@@ -3,6 +3,13 @@
 #include <string.h>
 #include "binary.h"
 
+static const uint8_t PADDING[64] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+#ifdef MD5_REFERENCE
+
 static const uint32_t T[4][16] = {
     {0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
      0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
@@ -34,11 +41,6 @@ static const int X[4][16] = {
     {5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2},
     {0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9}};
 
-static const uint8_t PADDING[64] = {
-    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
 static uint32_t F(uint32_t b, uint32_t c, uint32_t d) { return (b & c) | (~b & d); }
 static uint32_t G(uint32_t b, uint32_t c, uint32_t d) { return (b & d) | (c & ~d); }
 static uint32_t H(uint32_t b, uint32_t c, uint32_t d) { return b ^ c ^ d; }
@@ -64,6 +66,36 @@ static void md5_block(uint32_t vq[4], const uint8_t y[64])
         vq[i] += abcd[i];
 }
 
+#else
+
+// 按小端读取 32 位字，编译器会将其合并为一次读取
+static inline uint32_t load_uint32(const uint8_t c[])
+{
+    return (uint32_t)c[0] | ((uint32_t)c[1] << 8) | ((uint32_t)c[2] << 16) | ((uint32_t)c[3] << 24);
+}
+
+// 单路的压缩函数，见 md5_kernel.h；逐次查表、通过函数指针调用轮函数的版本在 make REFERENCE=1 时使用
+#define MD5_LANE uint32_t
+#define MD5_NAME(name) name##_scalar
+#define MD5_TARGET
+#include "md5_kernel.h"
+
+static void md5_block(uint32_t vq[4], const uint8_t y[64])
+{
+    uint32_t x[16];
+    for (int i = 0; i < 16; ++i)
+        x[i] = load_uint32(y + i * 4);
+    md5_rounds_scalar(vq, x);
+}
+
+#endif // MD5_REFERENCE
+
+void md5_blocks(uint32_t state[4], const uint8_t data[], size_t nblocks)
+{
+    for (size_t i = 0; i < nblocks; ++i)
+        md5_block(state, data + i * 64);
+}
+
 void md5_stream_begin(struct md5_stream *stream)
 {
     stream->vector[0] = 0x67452301;
@@ -74,22 +106,32 @@ void md5_stream_begin(struct md5_stream *stream)
     stream->total_len = 0;
 }
 
-void md5_stream_data(struct md5_stream *stream, uint8_t data[], int len)
+void md5_stream_data(struct md5_stream *stream, const uint8_t data[], size_t len)
 {
-    while (len > 0)
+    stream->total_len += len;
+
+    // 先补满上次剩下的不完整的块
+    if (stream->len > 0)
     {
-        int delta = 64 - stream->len < len ? 64 - stream->len : len;
+        size_t delta = (size_t)(64 - stream->len) < len ? (size_t)(64 - stream->len) : len;
         memcpy(stream->data + stream->len, data, delta);
         data += delta;
         len -= delta;
         stream->len += delta;
-        stream->total_len += delta;
-        if (stream->len >= 64)
-        {
-            md5_block(stream->vector, stream->data);
-            stream->len = 0;
-        }
+        if (stream->len < 64)
+            return;
+        md5_block(stream->vector, stream->data);
+        stream->len = 0;
     }
+
+    // 完整的块不经过缓存
+    size_t nblocks = len / 64;
+    md5_blocks(stream->vector, data, nblocks);
+    data += nblocks * 64;
+    len -= nblocks * 64;
+
+    memcpy(stream->data, data, len);
+    stream->len = len;
 }
 
 void md5_stream_end(struct md5_stream *stream, uint8_t result[16])
@@ -0,0 +1,157 @@
+/**
+ * MD5 压缩函数模板，由 md5.c 和 md5_mb.c 以不同的类型多次包含。
+ * 包含前需要定义：
+ *   MD5_LANE   保存 32 位字的类型，uint32_t 或者每一路一个 32 位字的 GCC 向量类型
+ *   MD5_NAME   为函数名加上后缀
+ *   MD5_TARGET 函数的 target 属性，用于生成对应指令集的代码
+ *   MD5_LANES  可选，向量的路数，定义时同时生成多路压缩函数 md5_mb_blocks
+ */
+
+#ifndef MD5_KERNEL_STEPS
+#define MD5_KERNEL_STEPS
+
+// 与参考实现中的 F、G 等价，但少一次运算
+#define F(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define G(b, c, d) ((c) ^ ((d) & ((b) ^ (c))))
+#define H(b, c, d) ((b) ^ (c) ^ (d))
+#define I(b, c, d) ((c) ^ ((b) | ~(d)))
+
+/**
+ * 一次迭代：a = b + ((a + g(b, c, d) + X[k] + T[i]) <<< s)
+ * 寄存器不再轮换，而是在下一步中轮换参数的顺序
+ */
+#define STEP(g, a, b, c, d, xk, ti, s)            \
+    do                                            \
+    {                                             \
+        a += g(b, c, d) + (xk) + (ti);            \
+        a = ((a << (s)) | (a >> (32 - (s)))) + b; \
+    } while (0)
+
+#endif // MD5_KERNEL_STEPS
+
+/**
+ * @brief MD5 压缩函数，64 次迭代全部展开
+ * @note 常数和循环左移位数都是立即数，状态保存在局部变量中，编译器可以把它们都分配到寄存器里
+ * @param state 链接变量，结果原地更新
+ * @param x 消息分组的 16 个字
+ */
+static inline MD5_TARGET void MD5_NAME(md5_rounds)(MD5_LANE state[4], const MD5_LANE x[16])
+{
+    MD5_LANE a = state[0], b = state[1], c = state[2], d = state[3];
+
+    // clang-format off
+    STEP(F, a, b, c, d, x[ 0], 0xd76aa478,  7);
+    STEP(F, d, a, b, c, x[ 1], 0xe8c7b756, 12);
+    STEP(F, c, d, a, b, x[ 2], 0x242070db, 17);
+    STEP(F, b, c, d, a, x[ 3], 0xc1bdceee, 22);
+    STEP(F, a, b, c, d, x[ 4], 0xf57c0faf,  7);
+    STEP(F, d, a, b, c, x[ 5], 0x4787c62a, 12);
+    STEP(F, c, d, a, b, x[ 6], 0xa8304613, 17);
+    STEP(F, b, c, d, a, x[ 7], 0xfd469501, 22);
+    STEP(F, a, b, c, d, x[ 8], 0x698098d8,  7);
+    STEP(F, d, a, b, c, x[ 9], 0x8b44f7af, 12);
+    STEP(F, c, d, a, b, x[10], 0xffff5bb1, 17);
+    STEP(F, b, c, d, a, x[11], 0x895cd7be, 22);
+    STEP(F, a, b, c, d, x[12], 0x6b901122,  7);
+    STEP(F, d, a, b, c, x[13], 0xfd987193, 12);
+    STEP(F, c, d, a, b, x[14], 0xa679438e, 17);
+    STEP(F, b, c, d, a, x[15], 0x49b40821, 22);
+
+    STEP(G, a, b, c, d, x[ 1], 0xf61e2562,  5);
+    STEP(G, d, a, b, c, x[ 6], 0xc040b340,  9);
+    STEP(G, c, d, a, b, x[11], 0x265e5a51, 14);
+    STEP(G, b, c, d, a, x[ 0], 0xe9b6c7aa, 20);
+    STEP(G, a, b, c, d, x[ 5], 0xd62f105d,  5);
+    STEP(G, d, a, b, c, x[10], 0x02441453,  9);
+    STEP(G, c, d, a, b, x[15], 0xd8a1e681, 14);
+    STEP(G, b, c, d, a, x[ 4], 0xe7d3fbc8, 20);
+    STEP(G, a, b, c, d, x[ 9], 0x21e1cde6,  5);
+    STEP(G, d, a, b, c, x[14], 0xc33707d6,  9);
+    STEP(G, c, d, a, b, x[ 3], 0xf4d50d87, 14);
+    STEP(G, b, c, d, a, x[ 8], 0x455a14ed, 20);
+    STEP(G, a, b, c, d, x[13], 0xa9e3e905,  5);
+    STEP(G, d, a, b, c, x[ 2], 0xfcefa3f8,  9);
+    STEP(G, c, d, a, b, x[ 7], 0x676f02d9, 14);
+    STEP(G, b, c, d, a, x[12], 0x8d2a4c8a, 20);
+
+    STEP(H, a, b, c, d, x[ 5], 0xfffa3942,  4);
+    STEP(H, d, a, b, c, x[ 8], 0x8771f681, 11);
+    STEP(H, c, d, a, b, x[11], 0x6d9d6122, 16);
+    STEP(H, b, c, d, a, x[14], 0xfde5380c, 23);
+    STEP(H, a, b, c, d, x[ 1], 0xa4beea44,  4);
+    STEP(H, d, a, b, c, x[ 4], 0x4bdecfa9, 11);
+    STEP(H, c, d, a, b, x[ 7], 0xf6bb4b60, 16);
+    STEP(H, b, c, d, a, x[10], 0xbebfbc70, 23);
+    STEP(H, a, b, c, d, x[13], 0x289b7ec6,  4);
+    STEP(H, d, a, b, c, x[ 0], 0xeaa127fa, 11);
+    STEP(H, c, d, a, b, x[ 3], 0xd4ef3085, 16);
+    STEP(H, b, c, d, a, x[ 6], 0x04881d05, 23);
+    STEP(H, a, b, c, d, x[ 9], 0xd9d4d039,  4);
+    STEP(H, d, a, b, c, x[12], 0xe6db99e5, 11);
+    STEP(H, c, d, a, b, x[15], 0x1fa27cf8, 16);
+    STEP(H, b, c, d, a, x[ 2], 0xc4ac5665, 23);
+
+    STEP(I, a, b, c, d, x[ 0], 0xf4292244,  6);
+    STEP(I, d, a, b, c, x[ 7], 0x432aff97, 10);
+    STEP(I, c, d, a, b, x[14], 0xab9423a7, 15);
+    STEP(I, b, c, d, a, x[ 5], 0xfc93a039, 21);
+    STEP(I, a, b, c, d, x[12], 0x655b59c3,  6);
+    STEP(I, d, a, b, c, x[ 3], 0x8f0ccc92, 10);
+    STEP(I, c, d, a, b, x[10], 0xffeff47d, 15);
+    STEP(I, b, c, d, a, x[ 1], 0x85845dd1, 21);
+    STEP(I, a, b, c, d, x[ 8], 0x6fa87e4f,  6);
+    STEP(I, d, a, b, c, x[15], 0xfe2ce6e0, 10);
+    STEP(I, c, d, a, b, x[ 6], 0xa3014314, 15);
+    STEP(I, b, c, d, a, x[13], 0x4e0811a1, 21);
+    STEP(I, a, b, c, d, x[ 4], 0xf7537e82,  6);
+    STEP(I, d, a, b, c, x[11], 0xbd3af235, 10);
+    STEP(I, c, d, a, b, x[ 2], 0x2ad7d2bb, 15);
+    STEP(I, b, c, d, a, x[ 9], 0xeb86d391, 21);
+    // clang-format on
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+#ifdef MD5_LANES
+
+/**
+ * @brief 对 MD5_LANES 路相互独立的消息各压缩 nblocks 个块
+ * @note 第 i 路的状态保存在每个向量的第 i 个元素中，每个块的 16 个字从各路的数据中收集到 16 个向量里
+ * @param state 各路的链接变量，结果原地更新
+ * @param data 各路的数据，每路 nblocks * 64 字节，不要求对齐
+ */
+static MD5_TARGET void MD5_NAME(md5_mb_blocks)(uint32_t *const state[], const uint8_t *const data[], size_t nblocks)
+{
+    MD5_LANE v[4];
+    for (int j = 0; j < 4; ++j)
+        for (int i = 0; i < MD5_LANES; ++i)
+            v[j][i] = state[i][j];
+
+    for (size_t k = 0; k < nblocks; ++k)
+    {
+        MD5_LANE x[16];
+        for (int i = 0; i < MD5_LANES; ++i)
+        {
+            // 只在 x86 上以向量实例化，可以直接按小端读取
+            uint32_t words[16];
+            memcpy(words, data[i] + k * 64, 64);
+            for (int w = 0; w < 16; ++w)
+                x[w][i] = words[w];
+        }
+        MD5_NAME(md5_rounds)(v, x);
+    }
+
+    for (int j = 0; j < 4; ++j)
+        for (int i = 0; i < MD5_LANES; ++i)
+            state[i][j] = v[j][i];
+}
+
+#endif // MD5_LANES
+
+#undef MD5_LANE
+#undef MD5_NAME
+#undef MD5_TARGET
+#undef MD5_LANES
@@ -0,0 +1,166 @@
+#include "md5_mb.h"
+#include <stdint.h>
+#include <string.h>
+
+// 以不同的向量宽度实例化压缩函数，见 md5_kernel.h
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MD5_MB_X86
+
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+typedef uint32_t u32x16 __attribute__((vector_size(64)));
+
+#define MD5_LANE u32x4
+#define MD5_LANES 4
+#define MD5_NAME(name) name##_sse2
+#define MD5_TARGET __attribute__((target("sse2")))
+#include "md5_kernel.h"
+
+#define MD5_LANE u32x8
+#define MD5_LANES 8
+#define MD5_NAME(name) name##_avx2
+#define MD5_TARGET __attribute__((target("avx2")))
+#include "md5_kernel.h"
+
+#define MD5_LANE u32x16
+#define MD5_LANES 16
+#define MD5_NAME(name) name##_avx512
+#define MD5_TARGET __attribute__((target("avx512f")))
+#include "md5_kernel.h"
+
+static bool supports_sse2() { return __builtin_cpu_supports("sse2"); }
+static bool supports_avx2() { return __builtin_cpu_supports("avx2"); }
+static bool supports_avx512() { return __builtin_cpu_supports("avx512f"); }
+#endif
+
+static bool supports_scalar() { return true; }
+
+static void md5_mb_blocks_scalar(uint32_t *const state[], const uint8_t *const data[], size_t nblocks)
+{
+    md5_blocks(state[0], data[0], nblocks);
+}
+
+const md5_mb_backend_t MD5_MB_BACKENDS[] = {
+#ifdef MD5_MB_X86
+    {"avx512", 16, supports_avx512, md5_mb_blocks_avx512},
+    {"avx2", 8, supports_avx2, md5_mb_blocks_avx2},
+    {"sse2", 4, supports_sse2, md5_mb_blocks_sse2},
+#endif
+    {"scalar", 1, supports_scalar, md5_mb_blocks_scalar},
+    {NULL, 0, NULL, NULL}};
+
+const md5_mb_backend_t *md5_mb_backend(const char *name)
+{
+#ifdef MD5_MB_X86
+    __builtin_cpu_init();
+#endif
+    for (const md5_mb_backend_t *p = MD5_MB_BACKENDS; p->name; ++p)
+        if ((!name || strcmp(name, p->name) == 0) && p->supported())
+            return p;
+    return NULL;
+}
+
+/**
+ * 多路 MD5 中的一路
+ */
+struct lane
+{
+    struct md5_stream stream;
+    // 为 NULL 时该路空闲
+    struct md5_mb_job *job;
+    // 尚未压缩的数据
+    const uint8_t *data;
+    size_t remaining;
+};
+
+/**
+ * @brief 剩余的数据交给 md5_stream 完成填充，并把结果交还给队列
+ */
+static void finish_lane(struct md5_mb_queue *queue, struct lane *lane)
+{
+    struct md5_mb_job *job = lane->job;
+    md5_stream_data(&lane->stream, lane->data, lane->remaining);
+    md5_stream_end(&lane->stream, job->digest);
+    lane->job = NULL;
+    queue->done(queue, job);
+}
+
+void md5_mb_run(const md5_mb_backend_t *backend, struct md5_mb_queue *queue)
+{
+    if (!backend)
+        backend = md5_mb_backend(NULL);
+    int nlanes = backend->lanes;
+    struct lane lanes[MD5_MB_MAX_LANES];
+    for (int i = 0; i < nlanes; ++i)
+        lanes[i].job = NULL;
+
+    bool more = true;
+    while (true)
+    {
+        // 空闲的路从队列中取下一个任务
+        int active = 0, first = -1;
+        for (int i = 0; i < nlanes; ++i)
+        {
+            struct lane *lane = &lanes[i];
+            if (!lane->job && more)
+            {
+                lane->job = queue->next(queue);
+                more = lane->job != NULL;
+                if (lane->job)
+                {
+                    md5_stream_begin(&lane->stream);
+                    lane->data = lane->job->data;
+                    lane->remaining = lane->job->len;
+                }
+            }
+            if (lane->job)
+            {
+                active++;
+                if (first < 0)
+                    first = i;
+            }
+        }
+        if (active == 0)
+            break;
+
+        // 剩余不足一块的路完成填充；只剩一路时剩余的完整块也直接交给单路实现
+        size_t nblocks = SIZE_MAX;
+        bool finished = false;
+        for (int i = 0; i < nlanes; ++i)
+        {
+            struct lane *lane = &lanes[i];
+            if (!lane->job)
+                continue;
+            if (lane->remaining < 64 || active == 1)
+            {
+                finish_lane(queue, lane);
+                finished = true;
+            }
+            else if (lane->remaining / 64 < nblocks)
+                nblocks = lane->remaining / 64;
+        }
+        if (finished)
+            continue;
+
+        // 空闲的路重复计算第一路的数据，结果写到临时的状态中丢弃；临时状态清零，内核不会读到不确定的值
+        uint32_t *state[MD5_MB_MAX_LANES], scratch[MD5_MB_MAX_LANES][4] = {{0}};
+        const uint8_t *data[MD5_MB_MAX_LANES];
+        for (int i = 0; i < nlanes; ++i)
+        {
+            struct lane *lane = lanes[i].job ? &lanes[i] : &lanes[first];
+            state[i] = lanes[i].job ? lanes[i].stream.vector : scratch[i];
+            data[i] = lane->data;
+        }
+        backend->blocks(state, data, nblocks);
+        for (int i = 0; i < nlanes; ++i)
+        {
+            struct lane *lane = &lanes[i];
+            if (!lane->job)
+                continue;
+            lane->data += nblocks * 64;
+            lane->remaining -= nblocks * 64;
+            lane->stream.total_len += nblocks * 64;
+        }
+    }
+}